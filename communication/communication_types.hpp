@@ -18,7 +18,13 @@ enum class RequestType : std::size_t {
   OPENAT,
   STATX,
   UNLINKAT,
-  RENAMEAT
+  RENAMEAT,
+  MSG_RING,
+  RECV_PROVIDED,
+  READ_FIXED,
+  WRITE_FIXED,
+  SOCKET,
+  ACCEPT_MULTISHOT
 };
 
 // default unspecialised
@@ -87,6 +93,36 @@ struct ResponseDataTypes<RequestType::RENAMEAT> {
   using type = RenameatResponsePack;
 };
 
+template <>
+struct ResponseDataTypes<RequestType::MSG_RING> {
+  using type = MsgRingResponsePack;
+};
+
+template <>
+struct ResponseDataTypes<RequestType::RECV_PROVIDED> {
+  using type = ReadResponsePack;
+};
+
+template <>
+struct ResponseDataTypes<RequestType::READ_FIXED> {
+  using type = ReadResponsePack;
+};
+
+template <>
+struct ResponseDataTypes<RequestType::WRITE_FIXED> {
+  using type = WriteResponsePack;
+};
+
+template <>
+struct ResponseDataTypes<RequestType::SOCKET> {
+  using type = SocketResponsePack;
+};
+
+template <>
+struct ResponseDataTypes<RequestType::ACCEPT_MULTISHOT> {
+  using type = AcceptResponsePack;
+};
+
 template <RequestType Rt>
 using RespDataTypeMap = typename ResponseDataTypes<Rt>::type;
 
@@ -97,6 +133,9 @@ using ResponseVariant =
                  RespDataTypeMap<RequestType::ACCEPT>, RespDataTypeMap<RequestType::CONNECT>,
                  RespDataTypeMap<RequestType::OPENAT>, RespDataTypeMap<RequestType::STATX>,
                  RespDataTypeMap<RequestType::UNLINKAT>, RespDataTypeMap<RequestType::RENAMEAT>,
+                 RespDataTypeMap<RequestType::MSG_RING>, RespDataTypeMap<RequestType::RECV_PROVIDED>,
+                 RespDataTypeMap<RequestType::READ_FIXED>, RespDataTypeMap<RequestType::WRITE_FIXED>,
+                 RespDataTypeMap<RequestType::SOCKET>, RespDataTypeMap<RequestType::ACCEPT_MULTISHOT>,
                  std::monostate>;
 
 #endif
@@ -12,6 +12,7 @@ struct GenericResponsePack {
 struct ReadResponsePack : GenericResponsePack {
   size_t bytes_read{};
   uint8_t* buff{};
+  int buffer_id{-1};  // which provided buffer the kernel picked, for operations using a buffer ring
 };
 
 struct WriteResponsePack : GenericResponsePack {
@@ -33,11 +34,14 @@ struct WritevResponsePack : GenericResponsePack {
 
 struct AcceptResponsePack : GenericResponsePack {
   int fd{};
+  bool direct{};  // fd is a slot in the ring's direct file table
 };
 
 struct ConnectResponsePack : GenericResponsePack {};
 
-struct OpenatResponsePack : GenericResponsePack {};
+struct OpenatResponsePack : GenericResponsePack {
+  bool direct{};  // req_fd is a slot in the ring's direct file table
+};
 
 struct StatxResponsePack : GenericResponsePack {
   const char* pathname{};
@@ -52,4 +56,11 @@ struct RenameatResponsePack : GenericResponsePack {
   const char* newpathname{};
 };
 
+struct MsgRingResponsePack : GenericResponsePack {};
+
+struct SocketResponsePack : GenericResponsePack {
+  int fd{};
+  bool direct{};  // fd is a slot in the ring's direct file table
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "frame_pool.hpp"
+#include <array>
+#include <new>
+
+// poison cached blocks under ASan, so use after frees of pooled frames are still caught
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#define POISON_BLOCK(ptr, size) ASAN_POISON_MEMORY_REGION(ptr, size)
+#define UNPOISON_BLOCK(ptr, size) ASAN_UNPOISON_MEMORY_REGION(ptr, size)
+#else
+#define POISON_BLOCK(ptr, size) ((void)(ptr), (void)(size))
+#define UNPOISON_BLOCK(ptr, size) ((void)(ptr), (void)(size))
+#endif
+
+namespace {
+
+// size classes are the powers of two from MIN_CLASS_SIZE up to MAX_CLASS_SIZE
+constexpr const std::size_t MIN_CLASS_SIZE = 32;
+constexpr const std::size_t NUM_SIZE_CLASSES = 8;
+constexpr const std::size_t MAX_CLASS_SIZE = MIN_CLASS_SIZE << (NUM_SIZE_CLASSES - 1);
+
+// most blocks a class keeps hold of, any more are given back to the global allocator
+constexpr const std::size_t MAX_CACHED_PER_CLASS = 1024;
+
+struct FreeBlock {
+  FreeBlock* next{};
+};
+
+struct ThreadFramePool {
+  std::array<FreeBlock*, NUM_SIZE_CLASSES> free_lists{};
+  std::array<std::size_t, NUM_SIZE_CLASSES> num_cached{};
+  FramePoolStats stats{};
+  bool destroyed{};
+
+  ~ThreadFramePool() {
+    for (std::size_t class_idx = 0; class_idx < NUM_SIZE_CLASSES; class_idx++) {
+      auto block = free_lists[class_idx];
+      while (block != nullptr) {
+        UNPOISON_BLOCK(block, MIN_CLASS_SIZE << class_idx);
+        auto next = block->next;
+        ::operator delete(block);
+        block = next;
+      }
+    }
+
+    // frames freed after this (i.e by static objects at exit) go straight to the global allocator
+    destroyed = true;
+  }
+};
+
+thread_local ThreadFramePool pool{};
+
+std::size_t size_class(std::size_t size) {
+  std::size_t class_idx = 0;
+  for (std::size_t class_size = MIN_CLASS_SIZE; class_size < size; class_size <<= 1) {
+    class_idx++;
+  }
+  return class_idx;
+}
+
+}  // namespace
+
+void* FramePool::allocate(std::size_t size) {
+  if (size > MAX_CLASS_SIZE || pool.destroyed) {
+    pool.stats.oversized++;
+    return ::operator new(size);
+  }
+
+  const auto class_idx = size_class(size);
+  auto& free_list = pool.free_lists[class_idx];
+  if (free_list != nullptr) {
+    auto block = free_list;
+    UNPOISON_BLOCK(block, MIN_CLASS_SIZE << class_idx);
+    free_list = block->next;
+    pool.num_cached[class_idx]--;
+    pool.stats.hits++;
+    return block;
+  }
+
+  pool.stats.misses++;
+  return ::operator new(MIN_CLASS_SIZE << class_idx);
+}
+
+void FramePool::deallocate(void* ptr, std::size_t size) {
+  if (ptr == nullptr) {
+    return;
+  }
+
+  if (size > MAX_CLASS_SIZE || pool.destroyed) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  const auto class_idx = size_class(size);
+  if (pool.num_cached[class_idx] >= MAX_CACHED_PER_CLASS) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  auto block = ::new (ptr) FreeBlock{pool.free_lists[class_idx]};
+  pool.free_lists[class_idx] = block;
+  pool.num_cached[class_idx]++;
+  POISON_BLOCK(block, MIN_CLASS_SIZE << class_idx);
+}
+
+const FramePoolStats& FramePool::stats() {
+  return pool.stats;
+}
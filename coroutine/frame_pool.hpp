@@ -0,0 +1,29 @@
+#ifndef FRAME_POOL_
+#define FRAME_POOL_
+
+#include <cstddef>
+#include <cstdint>
+
+// counters for the calling thread's pool
+struct FramePoolStats {
+  uint64_t hits{};       // allocations served from a free list
+  uint64_t misses{};     // allocations which had to go to the global allocator for a new block
+  uint64_t oversized{};  // allocations too large for any size class, which skip the pool entirely
+};
+
+/*
+Per thread pool of fixed size blocks, used for coroutine frames and the task status blocks
+which go with them, since a task is spawned per connection or request and each one would
+otherwise cost a couple of trips to the global allocator
+
+Blocks come in power of two size classes, freed blocks are kept on an intrusive free list
+for their class (up to a limit) and handed out again by later allocations on the same thread
+*/
+class FramePool {
+public:
+  static void* allocate(std::size_t size);
+  static void deallocate(void* ptr, std::size_t size);
+  static const FramePoolStats& stats();
+};
+
+#endif
@@ -3,8 +3,12 @@
 
 #include <bits/types/struct_iovec.h>
 #include <cstddef>
+#include <exception>
 #include <liburing.h>
+#include <optional>
 #include <sys/socket.h>
+#include <type_traits>
+#include <variant>
 
 #include "communication/communication_channel.hpp"
 #include "communication/communication_types.hpp"
@@ -35,7 +39,10 @@ struct IOAwaitable {
 
   ErrorCodes error{};
   EventManager* const EV;
-  io_uring_sqe* const SQE;
+  const bool POLLED;     // whether this goes through the event manager's IOPOLL ring
+  io_uring_sqe* sqe{};   // only taken once awaited, so awaitables can be made before they're awaited
+  uint64_t user_data{};  // refers to req_data in the event manager's request table once queued
+  bool waiting_for_sqe{};  // parked on the event manager's SQE wait list
 
   bool await_ready() const noexcept {
     // if the initial return code is non zero then we have run into an error
@@ -43,23 +50,38 @@ struct IOAwaitable {
     return ErrorProcessing::is_there_an_error(error);
   }
 
-  void await_suspend(EvTask::Handle handle) {
+  bool await_suspend(EvTask::Handle handle) {
     channel = &handle.promise().state.com_data;
     req_data.handle = handle;  // just got the handle, so set it
 
-    // we're using the metadata to store the vector index
+    // we're using the metadata to store the managed coroutines store key
     req_data.coro_idx = handle.promise().state.metadata;
     req_data.coro_finished = &handle.promise().state.task_status_ptr->handler_done;
 
-    static_cast<DerivedAwaitable*>(this)->prepare_sqring_op(handle, SQE);
-    io_uring_sqe_set_data(SQE, &req_data);
+    // queue up behind anything already waiting for an SQE, so operations are admitted in order
+    if (!EV->sqe_waiters_pending()) {
+      sqe = EV->try_get_sqe(POLLED);
+    }
+    if (sqe == nullptr) {
+      // the queue is full, the event loop hands this an SQE once one frees up after its next submit
+      waiting_for_sqe = true;
+      EV->wait_for_sqe({this, POLLED, &IOAwaitable::admit_waiter});
+      return true;
+    }
+
+    prepare_sqe();
+
+    if (POLLED || EV->submissions_deferred()) {
+      return true;  // the event loop submits everything queued before it next waits
+    }
 
     auto ret = EV->submit_queued_entries();
     if (ret < 1) {  // since submit returns the number of entries submitted
       std::cerr << "io_uring_submit failed\n";
       error = ErrorProcessing::set_error_from_num<ErrorType::LIBURING_SUBMISSION_ERR_ERRNO>(error, -ret);
-      handle.resume();
+      return false;  // don't suspend, so the error is returned straight away
     }
+    return true;
   }
 
   IOResponse<RespDataTypeMap<Rt>> await_resume() {
@@ -87,24 +109,63 @@ struct IOAwaitable {
     return {.data = data};
   }
 
-  IOAwaitable(EventManager* ev) : EV(ev), SQE(ev->get_uring_sqe()) {
-    if (SQE == nullptr) {
+  void prepare_sqe() {
+    static_cast<DerivedAwaitable*>(this)->prepare_sqring_op(req_data.handle, sqe);
+    if (req_data.fixed_file) {
+      sqe->flags |= IOSQE_FIXED_FILE;
+    }
+    user_data = EV->register_request(&req_data);
+    io_uring_sqe_set_data64(sqe, user_data);
+  }
+
+  // called by the event loop for awaitables on the SQE wait list, the SQE is nullptr if
+  // it won't ever get one (i.e the event manager is dying), in which case it fails instead
+  static void admit_waiter(void* awaitable, io_uring_sqe* free_sqe) {
+    auto self = static_cast<IOAwaitable*>(awaitable);
+    self->waiting_for_sqe = false;
+    if (free_sqe == nullptr) {
+      self->error = EventManagerErrors::SUBMISSION_QUEUE_FULL;
+      self->EV->schedule(self->req_data.handle);
+      return;
+    }
+
+    self->sqe = free_sqe;
+    self->prepare_sqe();
+  }
+
+  IOAwaitable(EventManager* ev, bool polled = false) : EV(ev), POLLED(polled) {
+    if (ev == nullptr || !ev->can_queue_operation(polled)) {
       error = EventManagerErrors::SUBMISSION_QUEUE_FULL;
     }
 
     req_data.req_type = Rt;
   }
+
+  ~IOAwaitable() {
+    // destroyed before it was handed an SQE, so the event loop mustn't hand it one later
+    if (waiting_for_sqe) {
+      EV->forget_sqe_wait(this);
+    }
+
+    // if the coroutine is destroyed with this still in flight, make sure its completion is ignored
+    // (a no-op once it has completed, since the entry is released then)
+    if (user_data != 0) {
+      EV->forget_request(user_data);
+    }
+  }
 };
 
 struct ReadAwaitable : IOAwaitable<RequestType::READ, ReadAwaitable> {
   void prepare_sqring_op(EvTask::Handle handle, io_uring_sqe* sqe) {
     auto& read_data = req_data.specific_data.read_data;
-    io_uring_prep_read(sqe, read_data.fd, read_data.buffer, read_data.length, 0);
+    io_uring_prep_read(sqe, read_data.fd, read_data.buffer, read_data.length, read_data.offset);
   }
 
-  ReadAwaitable(int fd, uint8_t* buff, size_t length, EventManager* ev) : IOAwaitable(ev) {
+  ReadAwaitable(int fd, uint8_t* buff, size_t length, EventManager* ev, uint64_t offset = 0,
+                bool polled = false)
+      : IOAwaitable(ev, polled) {
     auto& read_data = req_data.specific_data.read_data;
-    read_data = {fd, buff, length};
+    read_data = {fd, buff, length, offset};
   }
 
   // default initialiser
@@ -114,12 +175,14 @@ struct ReadAwaitable : IOAwaitable<RequestType::READ, ReadAwaitable> {
 struct WriteAwaitable : IOAwaitable<RequestType::WRITE, WriteAwaitable> {
   void prepare_sqring_op(EvTask::Handle handle, io_uring_sqe* sqe) {
     auto& write_data = req_data.specific_data.write_data;
-    io_uring_prep_write(sqe, write_data.fd, write_data.buffer, write_data.length, 0);
+    io_uring_prep_write(sqe, write_data.fd, write_data.buffer, write_data.length, write_data.offset);
   }
 
-  WriteAwaitable(int fd, const uint8_t* buff, size_t length, EventManager* ev) : IOAwaitable(ev) {
+  WriteAwaitable(int fd, const uint8_t* buff, size_t length, EventManager* ev, uint64_t offset = 0,
+                 bool polled = false)
+      : IOAwaitable(ev, polled) {
     auto& write_data = req_data.specific_data.write_data;
-    write_data = {fd, buff, length};
+    write_data = {fd, buff, length, offset};
   }
 
   // default initialiser
@@ -129,12 +192,16 @@ struct WriteAwaitable : IOAwaitable<RequestType::WRITE, WriteAwaitable> {
 struct CloseAwaitable : IOAwaitable<RequestType::CLOSE, CloseAwaitable> {
   void prepare_sqring_op(EvTask::Handle handle, io_uring_sqe* sqe) {
     auto& close_data = req_data.specific_data.close_data;
-    io_uring_prep_close(sqe, close_data.fd);
+    if (close_data.direct) {
+      io_uring_prep_close_direct(sqe, static_cast<unsigned>(close_data.fd));
+    } else {
+      io_uring_prep_close(sqe, close_data.fd);
+    }
   }
 
-  CloseAwaitable(int fd, EventManager* ev) : IOAwaitable(ev) {
+  CloseAwaitable(int fd, EventManager* ev, bool direct = false) : IOAwaitable(ev) {
     auto& close_data = req_data.specific_data.close_data;
-    close_data = {fd};
+    close_data = {fd, direct};
   }
 
   // default initialiser
@@ -189,12 +256,18 @@ struct WritevAwaitable : IOAwaitable<RequestType::WRITEV, WritevAwaitable> {
 struct AcceptAwaitable : IOAwaitable<RequestType::ACCEPT, AcceptAwaitable> {
   void prepare_sqring_op(EvTask::Handle handle, io_uring_sqe* sqe) {
     auto& accept_data = req_data.specific_data.accept_data;
-    io_uring_prep_accept(sqe, accept_data.sockfd, accept_data.addr, accept_data.addrlen, 0);
+    if (accept_data.direct) {
+      io_uring_prep_accept_direct(sqe, accept_data.sockfd, accept_data.addr, accept_data.addrlen, 0,
+                                  IORING_FILE_INDEX_ALLOC);
+    } else {
+      io_uring_prep_accept(sqe, accept_data.sockfd, accept_data.addr, accept_data.addrlen, 0);
+    }
   }
 
-  AcceptAwaitable(int sockfd, sockaddr* addr, socklen_t* addrlen, EventManager* ev) : IOAwaitable(ev) {
+  AcceptAwaitable(int sockfd, sockaddr* addr, socklen_t* addrlen, EventManager* ev, bool direct = false)
+      : IOAwaitable(ev) {
     auto& accept_data = req_data.specific_data.accept_data;
-    accept_data = {sockfd, addr, addrlen};
+    accept_data = {sockfd, addr, addrlen, direct};
   }
 
   // default initialiser
@@ -219,13 +292,19 @@ struct ConnectAwaitable : IOAwaitable<RequestType::CONNECT, ConnectAwaitable> {
 struct OpenatAwaitable : IOAwaitable<RequestType::OPENAT, OpenatAwaitable> {
   void prepare_sqring_op(EvTask::Handle handle, io_uring_sqe* sqe) {
     auto& openat_data = req_data.specific_data.openat_data;
-    io_uring_prep_openat(sqe, openat_data.dirfd, openat_data.pathname, openat_data.flags, openat_data.mode);
+    if (openat_data.direct) {
+      io_uring_prep_openat_direct(sqe, openat_data.dirfd, openat_data.pathname, openat_data.flags,
+                                  openat_data.mode, IORING_FILE_INDEX_ALLOC);
+    } else {
+      io_uring_prep_openat(sqe, openat_data.dirfd, openat_data.pathname, openat_data.flags, openat_data.mode);
+    }
   }
 
-  OpenatAwaitable(int dirfd, const char* pathname, int flags, mode_t mode, EventManager* ev)
+  OpenatAwaitable(int dirfd, const char* pathname, int flags, mode_t mode, EventManager* ev,
+                  bool direct = false)
       : IOAwaitable(ev) {
     auto& openat_data = req_data.specific_data.openat_data;
-    openat_data = {dirfd, pathname, flags, mode};
+    openat_data = {dirfd, pathname, flags, mode, direct};
   }
 
   // default initialiser
@@ -283,4 +362,166 @@ struct RenameatAwaitable : IOAwaitable<RequestType::RENAMEAT, RenameatAwaitable>
   RenameatAwaitable() : IOAwaitable(nullptr) {}
 };
 
+struct MsgRingAwaitable : IOAwaitable<RequestType::MSG_RING, MsgRingAwaitable> {
+  void prepare_sqring_op(EvTask::Handle handle, io_uring_sqe* sqe) {
+    auto& msg_ring_data = req_data.specific_data.msg_ring_data;
+    io_uring_prep_msg_ring(sqe, msg_ring_data.ring_fd, static_cast<uint32_t>(msg_ring_data.value),
+                           RequestTable::posted_user_data(msg_ring_data), 0);
+  }
+
+  MsgRingAwaitable(int ring_fd, uint64_t data, int32_t value, EvTask* task, EventManager* ev)
+      : IOAwaitable(ev) {
+    auto& msg_ring_data = req_data.specific_data.msg_ring_data;
+    msg_ring_data = {ring_fd, data, value, task};
+  }
+
+  // default initialiser
+  MsgRingAwaitable() : IOAwaitable(nullptr) {}
+
+  ~MsgRingAwaitable() {
+    // a task which was never queued is still ours, once queued the completion handler deals with it
+    if (user_data == 0) {
+      delete req_data.specific_data.msg_ring_data.task;
+    }
+  }
+};
+
+struct RecvProvidedAwaitable : IOAwaitable<RequestType::RECV_PROVIDED, RecvProvidedAwaitable> {
+  void prepare_sqring_op(EvTask::Handle handle, io_uring_sqe* sqe) {
+    auto& recv_provided_data = req_data.specific_data.recv_provided_data;
+    io_uring_prep_recv(sqe, recv_provided_data.sockfd, nullptr, recv_provided_data.buffers->buffer_size(),
+                       recv_provided_data.flags);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = recv_provided_data.buffers->group_id();
+  }
+
+  RecvProvidedAwaitable(int sockfd, ProvidedBufferRing* buffers, int flags, EventManager* ev)
+      : IOAwaitable(ev) {
+    auto& recv_provided_data = req_data.specific_data.recv_provided_data;
+    recv_provided_data = {sockfd, buffers, flags};
+  }
+
+  // default initialiser
+  RecvProvidedAwaitable() : IOAwaitable(nullptr) {}
+};
+
+struct ReadFixedAwaitable : IOAwaitable<RequestType::READ_FIXED, ReadFixedAwaitable> {
+  void prepare_sqring_op(EvTask::Handle handle, io_uring_sqe* sqe) {
+    auto& read_fixed_data = req_data.specific_data.read_fixed_data;
+    io_uring_prep_read_fixed(sqe, read_fixed_data.fd, read_fixed_data.buffer,
+                             static_cast<unsigned>(read_fixed_data.length), read_fixed_data.offset,
+                             static_cast<int>(read_fixed_data.buf_index));
+  }
+
+  ReadFixedAwaitable(int fd, unsigned buf_index, size_t buf_offset, uint8_t* buffer, size_t length,
+                     uint64_t offset, EventManager* ev)
+      : IOAwaitable(ev) {
+    auto& read_fixed_data = req_data.specific_data.read_fixed_data;
+    read_fixed_data = {fd, buf_index, buf_offset, length, offset, buffer};
+  }
+
+  // default initialiser
+  ReadFixedAwaitable() : IOAwaitable(nullptr) {}
+};
+
+struct WriteFixedAwaitable : IOAwaitable<RequestType::WRITE_FIXED, WriteFixedAwaitable> {
+  void prepare_sqring_op(EvTask::Handle handle, io_uring_sqe* sqe) {
+    auto& write_fixed_data = req_data.specific_data.write_fixed_data;
+    io_uring_prep_write_fixed(sqe, write_fixed_data.fd, write_fixed_data.buffer,
+                              static_cast<unsigned>(write_fixed_data.length), write_fixed_data.offset,
+                              static_cast<int>(write_fixed_data.buf_index));
+  }
+
+  WriteFixedAwaitable(int fd, unsigned buf_index, size_t buf_offset, const uint8_t* buffer, size_t length,
+                      uint64_t offset, EventManager* ev)
+      : IOAwaitable(ev) {
+    auto& write_fixed_data = req_data.specific_data.write_fixed_data;
+    write_fixed_data = {fd, buf_index, buf_offset, length, offset, buffer};
+  }
+
+  // default initialiser
+  WriteFixedAwaitable() : IOAwaitable(nullptr) {}
+};
+
+struct SocketAwaitable : IOAwaitable<RequestType::SOCKET, SocketAwaitable> {
+  void prepare_sqring_op(EvTask::Handle handle, io_uring_sqe* sqe) {
+    auto& socket_data = req_data.specific_data.socket_data;
+    if (socket_data.direct) {
+      io_uring_prep_socket_direct(sqe, socket_data.domain, socket_data.type, socket_data.protocol,
+                                  IORING_FILE_INDEX_ALLOC, 0);
+    } else {
+      io_uring_prep_socket(sqe, socket_data.domain, socket_data.type, socket_data.protocol, 0);
+    }
+  }
+
+  SocketAwaitable(int domain, int type, int protocol, EventManager* ev, bool direct = false)
+      : IOAwaitable(ev) {
+    auto& socket_data = req_data.specific_data.socket_data;
+    socket_data = {domain, type, protocol, direct};
+  }
+
+  // default initialiser
+  SocketAwaitable() : IOAwaitable(nullptr) {}
+};
+
+// runs fn on the offload pool and resumes the coroutine back on its own loop with what it returned
+// (or rethrows what it threw), if the event manager can't take it then fn runs in place
+template <typename Fn>
+struct OffloadAwaitable : OffloadJob {
+  using Result = std::invoke_result_t<Fn&>;
+  using Stored = std::conditional_t<std::is_void_v<Result>, std::monostate, Result>;
+
+  Fn fn;
+  std::optional<Stored> result{};
+  std::exception_ptr exception{};
+  bool offloaded{};
+
+  static void run_fn(OffloadJob* job) {
+    auto self = static_cast<OffloadAwaitable*>(job);
+    try {
+      if constexpr (std::is_void_v<Result>) {
+        self->fn();
+        self->result.emplace();
+      } else {
+        self->result.emplace(self->fn());
+      }
+    } catch (...) {
+      self->exception = std::current_exception();
+    }
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  bool await_suspend(std::coroutine_handle<> h) {
+    handle = h;
+    offloaded = home->submit_offload(this);
+    if (!offloaded) {
+      run_fn(this);
+    }
+    return offloaded;
+  }
+
+  Result await_resume() {
+    if (offloaded) {
+      home->finish_offload();
+    }
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+    if constexpr (!std::is_void_v<Result>) {
+      return std::move(result.value());
+    }
+  }
+
+  OffloadAwaitable(Fn&& fn, EventManager* ev)
+      : OffloadJob{&OffloadAwaitable::run_fn, ev}, fn(std::move(fn)) {}
+};
+
+template <typename Fn>
+OffloadAwaitable<Fn> EventManager::offload(Fn fn) {
+  return OffloadAwaitable<Fn>{std::move(fn), this};
+}
+
 #endif
\ No newline at end of file
@@ -1,5 +1,21 @@
 #include "task.hpp"
 
+void* TaskStatus::operator new(std::size_t size) {
+  return FramePool::allocate(size);
+}
+
+void TaskStatus::operator delete(void* ptr, std::size_t size) {
+  FramePool::deallocate(ptr, size);
+}
+
+void* EvTask::promise_type::operator new(std::size_t size) {
+  return FramePool::allocate(size);
+}
+
+void EvTask::promise_type::operator delete(void* ptr, std::size_t size) {
+  FramePool::deallocate(ptr, size);
+}
+
 EvTask EvTask::promise_type::get_return_object() {
   return EvTask{Handle::from_promise(*this)};
 }
@@ -8,15 +24,31 @@ std::suspend_always EvTask::promise_type::initial_suspend() noexcept {
   return {};
 }
 
-std::suspend_never EvTask::promise_type::final_suspend() noexcept {
-  if (state.awaiter_handle) {
-    state.awaiter_handle.resume();
-  }
+EvTask::promise_type::FinalAwaiter EvTask::promise_type::final_suspend() noexcept {
+  return {};
+}
 
+std::coroutine_handle<> EvTask::promise_type::FinalAwaiter::await_suspend(Handle h) noexcept {
+  auto& state = h.promise().state;
   if (state.task_status_ptr) {
     state.task_status_ptr->handler_done = true;
   }
-  return {};
+
+  // take what's needed before freeing the frame, the awaiter is then resumed by returning it
+  auto awaiter_handle = state.awaiter_handle;
+  auto on_finished = state.on_finished;
+  auto owner = state.owner;
+  auto metadata = state.metadata;
+  h.destroy();
+
+  if (on_finished) {
+    on_finished(owner, metadata);
+  }
+
+  if (awaiter_handle) {
+    return awaiter_handle;
+  }
+  return std::noop_coroutine();
 }
 
 void EvTask::promise_type::return_value(uint64_t ret_code) {
@@ -27,6 +59,9 @@ void EvTask::promise_type::return_value(uint64_t ret_code) {
 
 void EvTask::promise_type::unhandled_exception() {
   state.exception_ptr = std::current_exception();
+  if (state.task_status_ptr) {
+    state.task_status_ptr->exception_ptr = state.exception_ptr;
+  }
 }
 
 bool EvTask::promise_type::is_done() {
@@ -87,6 +122,17 @@ int EvTask::set_coro_metadata(uint64_t metadata) {
   return 0;
 }
 
+int EvTask::set_on_finished(void (*on_finished)(void* owner, uint64_t metadata), void* owner) {
+  if (!_handle) {
+    return -1;
+  }
+
+  auto& state = _handle.promise().state;
+  state.on_finished = on_finished;
+  state.owner = owner;
+  return 0;
+}
+
 std::optional<uint64_t> EvTask::get_coro_metadata() {
   if (!_handle) {
     return std::nullopt;
@@ -133,31 +179,41 @@ bool EvTask::await_ready() const noexcept {
   return false;
 };
 
-void EvTask::await_suspend(Handle other_handle) {
-  // if the coroutine hasn't started upon co_awaiting, do that first
-  if (!_started_coro) {
-    start();
-  }
-
-  // in the off chance we're awaiting on a complete coroutine
+std::coroutine_handle<> EvTask::await_suspend(Handle other_handle) {
+  // in the off chance we're awaiting on a complete coroutine, carry straight on
   if (_task_status_ptr && _task_status_ptr->handler_done) {
-    other_handle.resume();
-    return;
+    return other_handle;
   }
 
   auto& state = this->_handle.promise().state;
-  auto& awaiter_handle = state.awaiter_handle;
-  awaiter_handle = other_handle;
+  state.awaiter_handle = other_handle;
+
+  // if the coroutine hasn't started upon co_awaiting, switch straight to it, otherwise
+  // it resumes us from its final suspend point once it's done
+  if (!_started_coro) {
+    _started_coro = true;
+    return _handle;
+  }
+  return std::noop_coroutine();
 }
 
 uint64_t EvTask::await_resume() {
   if (_task_status_ptr) {
+    if (_task_status_ptr->exception_ptr) {
+      std::rethrow_exception(_task_status_ptr->exception_ptr);
+    }
     return _task_status_ptr->ret_code;
   }
   return -1;
 }
 
 EvTask::~EvTask() {
+  // nothing else can ever resume a task which was never started (i.e one a pool refused), so free it here
+  if (_handle && !_started_coro) {
+    _handle.destroy();
+    return;
+  }
+
   if (_task_status_ptr && !_task_status_ptr->handler_done) {
     _handle.promise().state.task_status_ptr = nullptr;
   }
@@ -3,8 +3,10 @@
 
 #include "communication/communication_channel.hpp"
 #include "communication/communication_types.hpp"
+#include "coroutine/frame_pool.hpp"
 
 #include <coroutine>
+#include <exception>
 #include <iostream>
 #include <memory>
 #include <optional>
@@ -12,6 +14,11 @@
 struct TaskStatus {
   bool handler_done{};
   uint64_t ret_code{};
+  std::exception_ptr exception_ptr{};  // outlives the frame, so awaiting tasks can rethrow it
+
+  // allocated alongside every task, so these come from the same per thread pool as the frames
+  static void* operator new(std::size_t size);
+  static void operator delete(void* ptr, std::size_t size);
 };
 
 class EvTask {
@@ -26,6 +33,16 @@ private:
 
 public:
   struct promise_type {
+    // hands control straight to the awaiting coroutine (if any) rather than resuming it from inside
+    // this one, and frees the frame on the way since nothing resumes or destroys a finished task
+    struct FinalAwaiter {
+      bool await_ready() const noexcept {
+        return false;
+      }
+      std::coroutine_handle<> await_suspend(Handle h) noexcept;
+      void await_resume() const noexcept {}
+    };
+
     struct {
       std::exception_ptr exception_ptr{};
       CommunicationChannel com_data{};
@@ -33,11 +50,19 @@ public:
       TaskStatus* task_status_ptr{};
 
       uint64_t metadata{};  // custom user provided metadata
+
+      // set for tasks an event manager holds on to, so it can let go of them once they've finished
+      void (*on_finished)(void* owner, uint64_t metadata){};
+      void* owner{};
     } state;
 
+    // frames come from the per thread FramePool rather than straight from the global allocator
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size);
+
     EvTask get_return_object();
     std::suspend_always initial_suspend() noexcept;
-    std::suspend_never final_suspend() noexcept;
+    FinalAwaiter final_suspend() noexcept;
     void return_value(uint64_t ret_code = 0);
     void unhandled_exception();
     bool is_done();
@@ -52,6 +77,8 @@ public:
   EvTask(EvTask&& other);
   EvTask& operator=(EvTask&& other);
   int set_coro_metadata(uint64_t metadata);
+  // called with the metadata once the task finishes, after its frame has been freed
+  int set_on_finished(void (*on_finished)(void* owner, uint64_t metadata), void* owner);
   std::optional<uint64_t> get_coro_metadata();
   CommunicationChannel* start();
   void resume();
@@ -89,7 +116,7 @@ public:
 
   // below are what makes this task awaitable
   bool await_ready() const noexcept;
-  void await_suspend(Handle other_handle);
+  std::coroutine_handle<> await_suspend(Handle other_handle);
   uint64_t await_resume();
   ~EvTask();
 };
@@ -0,0 +1,207 @@
+#include "accept_stream.hpp"
+#include <cerrno>
+#include <iostream>
+#include <unistd.h>
+#include <utility>
+
+AcceptStream::AcceptStream(EventManager* ev, int sockfd, bool direct) : _ev(ev) {
+  _req_data.req_type = RequestType::ACCEPT_MULTISHOT;
+  _req_data.specific_data.accept_multishot_data = {sockfd, direct, this};
+  arm();
+}
+
+namespace {
+// a stream being destroyed can't wait for an SQE, so flush the queue to make room instead
+io_uring_sqe* sqe_for_cleanup(EventManager* ev) {
+  auto sqe = ev->get_uring_sqe();
+  if (sqe == nullptr) {
+    ev->submit_queued_entries();
+    sqe = ev->get_uring_sqe();
+  }
+  return sqe;
+}
+}  // namespace
+
+AcceptStream::~AcceptStream() {
+  if (_waiting_for_sqe) {
+    _ev->forget_sqe_wait(this);
+  }
+  if (_waiter != nullptr) {
+    _waiter->stream = nullptr;
+  }
+
+  if (_user_data != 0) {
+    // anything accepted from now on is closed by the event manager, since there's no stream to hand it to
+    _ev->forget_request(_user_data);
+    if (auto sqe = sqe_for_cleanup(_ev); sqe != nullptr) {
+      io_uring_prep_cancel64(sqe, _user_data, 0);
+      io_uring_sqe_set_data64(sqe, 0);
+    } else {
+      std::cerr << "Unable to cancel a destroyed stream's accept, closing what it accepts instead\n";
+    }
+  }
+
+  // connections nobody took are closed rather than leaked
+  for (auto& accepted : _accepted) {
+    if (!accepted.direct) {
+      ::close(accepted.fd);
+      continue;
+    }
+    if (auto sqe = sqe_for_cleanup(_ev); sqe != nullptr) {
+      io_uring_prep_close_direct(sqe, static_cast<unsigned>(accepted.fd));
+      io_uring_sqe_set_data64(sqe, 0);
+      _ev->fixed_files().slot_emptied(static_cast<unsigned>(accepted.fd));
+    } else {
+      std::cerr << "Unable to close direct file table slot " << accepted.fd << ", it stays in use\n";
+    }
+  }
+}
+
+void AcceptStream::arm() {
+  if (!_ev->can_queue_operation(false)) {
+    end(ECANCELED);
+    return;
+  }
+
+  // behind anything already waiting for an SQE, like the awaitables
+  io_uring_sqe* sqe = nullptr;
+  if (!_ev->sqe_waiters_pending()) {
+    sqe = _ev->try_get_sqe(false);
+  }
+  if (sqe == nullptr) {
+    _waiting_for_sqe = true;
+    _ev->wait_for_sqe({this, false, &AcceptStream::admit});
+    return;
+  }
+  arm_with(sqe);
+}
+
+void AcceptStream::arm_with(io_uring_sqe* sqe) {
+  const auto& accept_data = _req_data.specific_data.accept_multishot_data;
+  if (accept_data.direct) {
+    io_uring_prep_multishot_accept_direct(sqe, accept_data.sockfd, nullptr, nullptr, 0);
+  } else {
+    io_uring_prep_multishot_accept(sqe, accept_data.sockfd, nullptr, nullptr, 0);
+  }
+
+  // left for the loop to submit along with everything else before it next waits
+  _user_data = _ev->register_request(&_req_data);
+  io_uring_sqe_set_data64(sqe, _user_data);
+}
+
+void AcceptStream::admit(void* stream, io_uring_sqe* sqe) {
+  auto self = static_cast<AcceptStream*>(stream);
+  self->_waiting_for_sqe = false;
+  if (sqe == nullptr) {
+    self->end(ECANCELED);  // the event manager won't take any more operations
+    self->wake_waiter();
+    return;
+  }
+  self->arm_with(sqe);
+}
+
+void AcceptStream::handle_completion(int res, uint32_t cqe_flags) {
+  const auto& accept_data = _req_data.specific_data.accept_multishot_data;
+  const bool more = cqe_flags & IORING_CQE_F_MORE;
+  if (!more) {
+    _user_data = 0;  // the kernel is done with this accept, and its entry has been released
+  }
+
+  if (res >= 0) {
+    if (accept_data.direct) {
+      _ev->fixed_files().slot_filled();
+    }
+    AcceptResponsePack accepted{};
+    accepted.fd = res;
+    accepted.direct = accept_data.direct;
+    accepted.req_fd = accept_data.sockfd;
+    _accepted.push_back(accepted);
+  }
+
+  if (!more && !ended()) {
+    // a connection which went away before it was accepted doesn't stop the stream either
+    if (!_cancelled && (res >= 0 || res == -ECONNABORTED)) {
+      _rearms++;
+      arm();
+    } else {
+      end(_cancelled ? ECANCELED : -res);
+    }
+  }
+
+  wake_waiter();
+}
+
+void AcceptStream::cancel() {
+  if (_cancelled || ended()) {
+    return;
+  }
+  _cancelled = true;
+
+  if (_waiting_for_sqe) {
+    _ev->forget_sqe_wait(this);
+    _waiting_for_sqe = false;
+  }
+  if (_user_data == 0) {
+    end(ECANCELED);
+    wake_waiter();
+    return;
+  }
+
+  // the accept's last completion (-ECANCELED) ends the stream, after anything accepted before it
+  auto sqe = _ev->get_uring_sqe();
+  if (sqe == nullptr) {
+    // can't ask the kernel to stop, so stop listening to it instead
+    std::cerr << "Unable to cancel the multishot accept, ignoring it from now on\n";
+    _ev->forget_request(_user_data);
+    _user_data = 0;
+    end(ECANCELED);
+    wake_waiter();
+    return;
+  }
+  io_uring_prep_cancel64(sqe, _user_data, 0);
+  io_uring_sqe_set_data64(sqe, 0);
+}
+
+void AcceptStream::end(int error_num) {
+  _end_error = error_num;
+}
+
+void AcceptStream::wake_waiter() {
+  if (_waiter != nullptr && (!_accepted.empty() || ended())) {
+    _ev->schedule(std::exchange(_waiter, nullptr)->handle);
+  }
+}
+
+NextConnectionAwaitable::~NextConnectionAwaitable() {
+  // destroyed while waiting (along with its coroutine), so the stream mustn't resume it later
+  if (stream != nullptr && stream->_waiter == this) {
+    stream->_waiter = nullptr;
+  }
+}
+
+bool NextConnectionAwaitable::await_ready() const {
+  return !stream->_accepted.empty() || stream->ended();
+}
+
+void NextConnectionAwaitable::await_suspend(EvTask::Handle h) {
+  handle = h;
+  stream->_waiter = this;
+}
+
+IOResponse<AcceptResponsePack> NextConnectionAwaitable::await_resume() {
+  using namespace ErrorProcessing;
+
+  if (stream->_accepted.empty()) {
+    AcceptResponsePack data{};
+    data.fd = -1;
+    data.error_num = stream->_end_error;
+    data.req_fd = stream->_req_data.specific_data.accept_multishot_data.sockfd;
+    ErrorCodes error{};
+    error = set_error_from_num<ErrorType::OPERATION_ERR_ERRNO>(error, -data.error_num);
+    return {.error = error, .data = data};
+  }
+
+  auto data = stream->_accepted.front();
+  stream->_accepted.pop_front();
+  return {.data = data};
+}
@@ -0,0 +1,88 @@
+#ifndef ACCEPT_STREAM_
+#define ACCEPT_STREAM_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include "coroutine/io_awaitables.hpp"
+#include "event_loop/event_manager.hpp"
+#include "event_loop/request_data.hpp"
+
+class AcceptStream;
+
+// resumes once the stream has a connection (or has ended), straight away if it already has one
+struct NextConnectionAwaitable {
+  AcceptStream* stream{};
+  EvTask::Handle handle{};
+  ~NextConnectionAwaitable();
+  bool await_ready() const;
+  void await_suspend(EvTask::Handle h);
+  IOResponse<AcceptResponsePack> await_resume();
+};
+
+/*
+A multishot accept as a stream of connections, a single armed request keeps accepting (posting a
+completion per connection) rather than costing an SQE, a submit and a resume for every connection,
+which adds up when lots of connections arrive at once. Connections accepted before next() is awaited
+are held on to until it is
+
+The kernel may end a multishot accept by itself (i.e when the completion queue overflowed), in which
+case it's armed again, it only stops for good once it's cancelled, the event manager is killed or
+accepting fails, which next() reports once everything accepted before then has been handed out
+
+Only one coroutine should await next() at a time, and the stream must be used on its event manager's
+loop, and destroyed before the event manager is
+*/
+class AcceptStream {
+  EventManager* _ev{};
+  RequestData _req_data{};
+  uint64_t _user_data{};  // of the armed accept, 0 while there isn't one
+  bool _waiting_for_sqe{};
+  std::deque<AcceptResponsePack> _accepted{};
+  NextConnectionAwaitable* _waiter{};  // cleared by the awaitable if its coroutine is destroyed first
+  int _end_error{};  // why the stream ended, once it has
+  bool _cancelled{};
+  uint64_t _rearms{};
+
+  void arm();
+  void arm_with(io_uring_sqe* sqe);
+  static void admit(void* stream, io_uring_sqe* sqe);
+  void end(int error_num);
+  void wake_waiter();
+
+  friend struct NextConnectionAwaitable;
+
+public:
+  AcceptStream(EventManager* ev, int sockfd, bool direct = false);
+  ~AcceptStream();
+
+  AcceptStream(const AcceptStream&) = delete;
+  AcceptStream& operator=(const AcceptStream&) = delete;
+
+  // the next connection, or the error the stream ended with (ECANCELED once cancelled)
+  [[nodiscard]] NextConnectionAwaitable next() {
+    return {this};
+  }
+  // stops accepting, connections which were already accepted are still handed out by next()
+  void cancel();
+  // called by the event manager for each of the accept's completions
+  void handle_completion(int res, uint32_t cqe_flags);
+
+  bool armed() const {
+    return _user_data != 0 || _waiting_for_sqe;
+  }
+  bool ended() const {
+    return _end_error != 0;
+  }
+  // accepted, but not handed out yet
+  size_t pending() const {
+    return _accepted.size();
+  }
+  // times the kernel ended the accept by itself and it was armed again
+  uint64_t rearms() const {
+    return _rearms;
+  }
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "buffer_arena.hpp"
+#include <algorithm>
+#include <iostream>
+#include <sys/mman.h>
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+namespace {
+size_t round_up(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+}  // namespace
+
+BufferArena::BufferArena(size_t bytes, size_t slab_size) {
+  if (bytes == 0 || slab_size == 0) {
+    std::cerr << "Buffer arenas need a size and a slab size\n";
+    return;
+  }
+
+  _slab_size = round_up(slab_size, SMALL_PAGE_SIZE);
+  _bytes = round_up(std::max(bytes, _slab_size), HUGE_PAGE_SIZE);
+
+  // reserved huge pages first, which fails straight away if there aren't enough of them
+  void* base = mmap(nullptr, _bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+  if (base != MAP_FAILED) {
+    _backing = ArenaBacking::HUGETLB;
+  } else {
+    // otherwise map an extra huge page, so the arena can start on a huge page boundary, which THP needs
+    const size_t padded = _bytes + HUGE_PAGE_SIZE;
+    auto padded_base = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (padded_base == MAP_FAILED) {
+      perror("Unable to map the buffer arena");
+      _bytes = 0;
+      return;
+    }
+
+    const auto start = reinterpret_cast<uintptr_t>(padded_base);
+    const auto aligned = round_up(start, HUGE_PAGE_SIZE);
+    if (aligned != start) {
+      munmap(padded_base, aligned - start);
+    }
+    const auto end = start + padded;
+    if (end != aligned + _bytes) {
+      munmap(reinterpret_cast<void*>(aligned + _bytes), end - aligned - _bytes);
+    }
+
+    base = reinterpret_cast<void*>(aligned);
+    _backing = madvise(base, _bytes, MADV_HUGEPAGE) == 0 ? ArenaBacking::TRANSPARENT_HUGE_PAGES
+                                                         : ArenaBacking::REGULAR_PAGES;
+  }
+
+  _base = static_cast<uint8_t*>(base);
+  _num_slabs = _bytes / _slab_size;
+
+  // a stack of free slabs, with the lowest addresses handed out first
+  _free_slabs.reserve(_num_slabs);
+  _in_use.assign(_num_slabs, false);
+  for (size_t i = _num_slabs; i != 0; i--) {
+    _free_slabs.push_back(static_cast<uint32_t>(i - 1));
+  }
+}
+
+BufferArena::~BufferArena() {
+  if (_base != nullptr) {
+    munmap(_base, _bytes);
+  }
+}
+
+uint8_t* BufferArena::allocate() {
+  if (_free_slabs.empty()) {
+    _failed_allocations++;
+    return nullptr;
+  }
+
+  auto idx = _free_slabs.back();
+  _free_slabs.pop_back();
+  _in_use[idx] = true;
+  _peak_in_use = std::max(_peak_in_use, _num_slabs - _free_slabs.size());
+  return slab(idx);
+}
+
+bool BufferArena::release(uint8_t* slab) {
+  if (!contains(slab) || static_cast<size_t>(slab - _base) % _slab_size != 0) {
+    std::cerr << "Released a slab which isn't from this buffer arena\n";
+    return false;
+  }
+
+  const auto idx = slab_index(slab);
+  if (!_in_use[idx]) {
+    std::cerr << "Released a slab of the buffer arena which isn't in use\n";
+    return false;
+  }
+  _in_use[idx] = false;
+  _free_slabs.push_back(static_cast<uint32_t>(idx));
+  return true;
+}
+
+BufferArenaStats BufferArena::stats() const {
+  return {.backing = _backing,
+          .bytes = _bytes,
+          .slab_size = _slab_size,
+          .slabs = _num_slabs,
+          .slabs_in_use = _num_slabs - _free_slabs.size(),
+          .peak_slabs_in_use = _peak_in_use,
+          .failed_allocations = _failed_allocations};
+}
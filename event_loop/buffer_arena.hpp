@@ -0,0 +1,92 @@
+#ifndef BUFFER_ARENA_
+#define BUFFER_ARENA_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// what ended up backing the arena's memory
+enum class ArenaBacking {
+  HUGETLB,                 // reserved 2 MiB huge pages (MAP_HUGETLB)
+  TRANSPARENT_HUGE_PAGES,  // regular mapping, with the kernel asked to use huge pages for it (MADV_HUGEPAGE)
+  REGULAR_PAGES            // neither was available
+};
+
+struct BufferArenaStats {
+  ArenaBacking backing{};
+  size_t bytes{};        // size of the whole mapping
+  size_t slab_size{};
+  size_t slabs{};
+  size_t slabs_in_use{};
+  size_t peak_slabs_in_use{};
+  uint64_t failed_allocations{};  // times allocate found no free slab
+
+  double utilisation() const {
+    return slabs == 0 ? 0.0 : static_cast<double>(slabs_in_use) / static_cast<double>(slabs);
+  }
+};
+
+/*
+One large mapping made from 2 MiB huge pages where possible (falling back to transparent huge pages, and
+then to regular pages), carved into equally sized slabs. The mapping is 2 MiB aligned and slabs are a
+multiple of the page size, so every slab is page aligned, which O_DIRECT needs, and fewer, bigger pages
+mean fewer TLB misses and less work pinning them when the slabs are registered as fixed buffers (see
+FixedBufferTable::setup_from_arena)
+
+Made (and owned) by the event manager, see EventManager::setup_buffer_arena, and only used from its loop
+*/
+class BufferArena {
+  uint8_t* _base{};
+  size_t _bytes{};
+  size_t _slab_size{};
+  size_t _num_slabs{};
+  ArenaBacking _backing{ArenaBacking::REGULAR_PAGES};
+  std::vector<uint32_t> _free_slabs{};
+  std::vector<bool> _in_use{};  // per slab, so a slab released twice isn't handed out twice
+  size_t _peak_in_use{};
+  uint64_t _failed_allocations{};
+
+public:
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+  static constexpr size_t SMALL_PAGE_SIZE = 4096;
+
+  // bytes is rounded up to whole huge pages and slab_size to whole pages, check mapped() afterwards
+  BufferArena(size_t bytes, size_t slab_size);
+  ~BufferArena();
+
+  BufferArena(const BufferArena&) = delete;
+  BufferArena& operator=(const BufferArena&) = delete;
+
+  bool mapped() const {
+    return _base != nullptr;
+  }
+
+  // nullptr once every slab is in use
+  uint8_t* allocate();
+  // only the start of a slab handed out by allocate, anything else is refused (false)
+  bool release(uint8_t* slab);
+
+  uint8_t* slab(size_t idx) const {
+    return _base + idx * _slab_size;
+  }
+  // which slab an address lies in, the same index the slab has once registered as a fixed buffer
+  size_t slab_index(const uint8_t* address) const {
+    return static_cast<size_t>(address - _base) / _slab_size;
+  }
+  bool contains(const uint8_t* address) const {
+    return _base != nullptr && address >= _base && address < _base + _num_slabs * _slab_size;
+  }
+
+  size_t slab_size() const {
+    return _slab_size;
+  }
+  size_t num_slabs() const {
+    return _num_slabs;
+  }
+  ArenaBacking backing() const {
+    return _backing;
+  }
+  BufferArenaStats stats() const;
+};
+
+#endif
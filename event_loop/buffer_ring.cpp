@@ -0,0 +1,60 @@
+#include "buffer_ring.hpp"
+#include "communication/response_packs.hpp"
+
+ProvidedBuffer::ProvidedBuffer(ProvidedBufferRing* ring, uint16_t id, size_t size)
+    : _ring(ring), _id(id), _data(ring->buffer(id)), _size(size) {}
+
+ProvidedBuffer::~ProvidedBuffer() {
+  release();
+}
+
+void ProvidedBuffer::release() {
+  if (_ring != nullptr) {
+    _ring->recycle(_id);
+    _ring = nullptr;
+    _data = nullptr;
+    _size = 0;
+  }
+}
+
+ProvidedBufferRing::ProvidedBufferRing(io_uring* ring, io_uring_buf_ring* buf_ring, uint16_t group_id,
+                                       uint32_t num_buffers, uint32_t buffer_size)
+    : _ring(ring), _buf_ring(buf_ring), _group_id(group_id), _num_buffers(num_buffers),
+      _buffer_size(buffer_size),
+      _storage(std::make_unique<uint8_t[]>(static_cast<size_t>(num_buffers) * buffer_size)) {
+  const auto mask = io_uring_buf_ring_mask(_num_buffers);
+  for (uint32_t id = 0; id < _num_buffers; id++) {
+    io_uring_buf_ring_add(_buf_ring, buffer(id), _buffer_size, id, mask, static_cast<int>(id));
+  }
+  io_uring_buf_ring_advance(_buf_ring, static_cast<int>(_num_buffers));
+}
+
+ProvidedBufferRing::~ProvidedBufferRing() {
+  unregister();
+}
+
+void ProvidedBufferRing::unregister() {
+  if (_buf_ring != nullptr) {
+    io_uring_free_buf_ring(_ring, _buf_ring, _num_buffers, _group_id);
+    _buf_ring = nullptr;
+  }
+}
+
+ProvidedBuffer ProvidedBufferRing::claim(const ReadResponsePack& data) {
+  if (data.buffer_id < 0) {
+    return {};
+  }
+  return {this, static_cast<uint16_t>(data.buffer_id), data.bytes_read};
+}
+
+void ProvidedBufferRing::recycle(uint16_t id) {
+  if (_in_use != 0) {
+    _in_use--;
+  }
+  if (_buf_ring == nullptr) {
+    return;  // the ring is gone, so there's nothing to give it back to
+  }
+
+  io_uring_buf_ring_add(_buf_ring, buffer(id), _buffer_size, id, io_uring_buf_ring_mask(_num_buffers), 0);
+  io_uring_buf_ring_advance(_buf_ring, 1);
+}
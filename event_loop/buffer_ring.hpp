@@ -0,0 +1,117 @@
+#ifndef BUFFER_RING_
+#define BUFFER_RING_
+
+#include <cstddef>
+#include <cstdint>
+#include <liburing.h>
+#include <memory>
+#include <utility>
+
+class ProvidedBufferRing;
+struct ReadResponsePack;
+
+// a buffer the kernel picked out of a ring for an operation, which is given back to the ring once
+// this is destroyed (or released), so it mustn't outlive the event manager which owns the ring
+class ProvidedBuffer {
+  ProvidedBufferRing* _ring{};
+  uint16_t _id{};
+  uint8_t* _data{};
+  size_t _size{};
+
+public:
+  ProvidedBuffer() = default;
+  ProvidedBuffer(ProvidedBufferRing* ring, uint16_t id, size_t size);
+  ~ProvidedBuffer();
+
+  ProvidedBuffer(ProvidedBuffer&& other) noexcept
+      : _ring(std::exchange(other._ring, nullptr)), _id(other._id),
+        _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) {}
+  ProvidedBuffer& operator=(ProvidedBuffer&& other) noexcept {
+    if (this != &other) {
+      release();
+      _ring = std::exchange(other._ring, nullptr);
+      _id = other._id;
+      _data = std::exchange(other._data, nullptr);
+      _size = std::exchange(other._size, 0);
+    }
+    return *this;
+  }
+  ProvidedBuffer(const ProvidedBuffer&) = delete;
+  ProvidedBuffer& operator=(const ProvidedBuffer&) = delete;
+
+  // give the buffer back to the ring early
+  void release();
+
+  explicit operator bool() const {
+    return _ring != nullptr;
+  }
+  uint16_t id() const {
+    return _id;
+  }
+  uint8_t* data() const {
+    return _data;
+  }
+  // the bytes the operation put in it, not the buffer's capacity
+  size_t size() const {
+    return _size;
+  }
+};
+
+/*
+Group of equally sized buffers registered with a ring (IORING_REGISTER_PBUF_RING), which operations
+using buffer select take a buffer from only once there's data for them. So idle connections don't
+need a buffer of their own while waiting, and memory use follows the amount of data in flight rather
+than the number of connections
+
+Made (and owned) by the event manager, see EventManager::setup_buffer_ring, and only used from its loop
+*/
+class ProvidedBufferRing {
+  io_uring* _ring{};
+  io_uring_buf_ring* _buf_ring{};
+  uint16_t _group_id{};
+  uint32_t _num_buffers{};
+  uint32_t _buffer_size{};
+  std::unique_ptr<uint8_t[]> _storage{};
+  size_t _in_use{};
+
+public:
+  // the buffer ring has to already be set up with io_uring_setup_buf_ring, and is empty until this fills it
+  ProvidedBufferRing(io_uring* ring, io_uring_buf_ring* buf_ring, uint16_t group_id, uint32_t num_buffers,
+                     uint32_t buffer_size);
+  ~ProvidedBufferRing();
+
+  ProvidedBufferRing(const ProvidedBufferRing&) = delete;
+  ProvidedBufferRing& operator=(const ProvidedBufferRing&) = delete;
+
+  // done before the ring is torn down, buffers given back after that are just dropped
+  void unregister();
+
+  // the buffer from a completion, an empty handle if the operation didn't get one
+  ProvidedBuffer claim(const ReadResponsePack& data);
+
+  // hands the buffer back to the kernel for another operation to use
+  void recycle(uint16_t id);
+  // only for completions where the kernel picked a buffer
+  void mark_taken() {
+    _in_use++;
+  }
+
+  uint8_t* buffer(uint16_t id) const {
+    return _storage.get() + static_cast<size_t>(id) * _buffer_size;
+  }
+  uint16_t group_id() const {
+    return _group_id;
+  }
+  uint32_t buffer_size() const {
+    return _buffer_size;
+  }
+  uint32_t num_buffers() const {
+    return _num_buffers;
+  }
+  // buffers the kernel can still pick from
+  size_t available() const {
+    return _num_buffers - _in_use;
+  }
+};
+
+#endif
@@ -1,11 +1,23 @@
 #include "communication/communication_types.hpp"
 #include "communication/response_packs.hpp"
+#include "event_loop/accept_stream.hpp"
 #include "event_loop/parameter_packs.hpp"
 #include "event_loop/request_data.hpp"
 #include "event_manager.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
 #include <coroutine>
 #include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
 #include <liburing.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
 
 int EventManager::shared_ring_fd = -1;
 size_t EventManager::ring_instances{};
@@ -15,6 +27,12 @@ std::mutex EventManager::init_mutex{};
 // and then fail with a message
 constexpr const size_t MAX_ITER = 1000;
 
+// how many CQEs are peeked at once when draining the completion queue
+constexpr const size_t CQE_BATCH_SIZE = 64;
+
+// the event manager whose loop is running on this thread
+thread_local EventManager* running_manager = nullptr;
+
 void EventManager::start() {
   if (_manager_life_state >= LivingState::LIVING) {
     std::cerr << "The event manager is past starting\n";
@@ -25,9 +43,11 @@ void EventManager::start() {
   }
 
   _manager_life_state = LivingState::LIVING;
+  running_manager = this;
   while (_manager_life_state < DEAD) {
     await_message();
   }
+  running_manager = nullptr;
 }
 
 void EventManager::await_message() {
@@ -38,18 +58,76 @@ void EventManager::await_message() {
     event_handler(res, req_data);
   }
 
-  io_uring_cqe* cqe;
-  int ret = io_uring_wait_cqe(&_ring, &cqe);
+  // completions for polled file I/O are only found by asking the kernel to poll for them, so
+  // do that every tick and don't block on the main ring while any of it is still outstanding
+  reap_polled_completions();
+  admit_sqe_waiters();
+  bool inbox_unarmed = false;
+  if (!_inbox_read_armed && _inbox_fd >= 0 && _manager_life_state == LivingState::LIVING) {
+    arm_inbox_read();
+    inbox_unarmed = !_inbox_read_armed;
+  }
 
-  if (ret < 0) {
-    perror("io_uring_wait_cqe");
+  // flush anything queued up since the last wakeup (i.e deferred submissions), and only
+  // block when there is nothing ready to be processed, doing both in one call if possible
+  // (coroutines on the run queue and requests waiting for the poll coroutine count as ready)
+  bool have_queued = io_uring_sq_ready(&_ring) != 0;
+  bool have_ready_work = !_run_queue.empty() || _stealable.size() != 0 || !_inbox.empty();
+  have_ready_work |= !_ready_requests_store.empty() && _polling_handle != nullptr;
+  // with no read on the inbox nothing would wake the loop for a push from another thread, so don't
+  // block until there's been an SQE to arm it with (flushing the full queue frees them up)
+  have_ready_work |= inbox_unarmed;
+  if (io_uring_cq_ready(&_ring) == 0 && !polling_files() && !have_ready_work && !steal_ready_work()) {
+    int ret = wait_for_completions(have_queued);
+    _idle.store(false);
+    if (ret < 0) {
+      if (ret != -EINTR && ret != -ETIME) {
+        errno = -ret;
+        perror("Waiting for completions failed");
+      }
+      return;
+    }
+  } else if (have_queued) {
+    // with DEFER_TASKRUN completions are only posted when asked for, so pick them up at the same time
+    submit_entries(0, _ring.flags & IORING_SETUP_DEFER_TASKRUN);
+  } else if (deferred_completions_pending()) {
+    io_uring_get_events(&_ring);
+  }
+
+  // drain everything that is ready in batches, advancing the CQ head once per batch, and
+  // queue the completions up so their coroutines are resumed afterwards
+  size_t processed = 0;
+  std::array<io_uring_cqe*, CQE_BATCH_SIZE> cqes{};
+  unsigned count = 0;
+  while ((count = io_uring_peek_batch_cqe(&_ring, cqes.data(), cqes.size())) != 0) {
+    size_t posted = 0;  // completions other rings posted here, which we never submitted anything for
+    size_t more = 0;    // completions from multishot requests which are still in flight
+    for (unsigned i = 0; i < count; i++) {
+      if (RequestTable::is_posted(io_uring_cqe_get_data64(cqes[i]))) {
+        receive_posted(cqes[i]);
+        posted++;
+        continue;
+      }
+      if (cqes[i]->flags & IORING_CQE_F_MORE) {
+        more++;
+      }
+      queue_completion(cqes[i]);
+    }
+
+    io_uring_cq_advance(&_ring, count);
+    _in_flight_requests -= count - posted - more;
+    processed += count;
   }
 
-  auto req_data = reinterpret_cast<RequestData*>(io_uring_cqe_get_data(cqe));
-  event_handler(cqe->res, req_data);
+  _stats.wakeups++;
+  _stats.cqes_processed += processed;
+  _stats.last_batch_size = processed;
+  _stats.max_batch_size = std::max(_stats.max_batch_size, processed);
 
-  io_uring_cqe_seen(&_ring, cqe);
-  _in_flight_requests--;  // seen one request
+  drain_inbox();
+  start_posted_tasks();
+  run_ready_coroutines();
+  erase_finished_tasks();
 
   // if the kill process has been started, then we must want an update
   if (_manager_life_state == LivingState::DYING) {
@@ -57,34 +135,127 @@ void EventManager::await_message() {
   }
 }
 
-EventManager::EventManager(size_t queue_depth) : _ready_requests_store({}), _kill_coro_task(kill_internal()) {
+EventManager::EventManager(size_t queue_depth, EventManagerOptions options)
+    : _options(options),
+      _ready_requests_store({}),
+      _request_data_chunk_size(std::max<size_t>(queue_depth, 1)),
+      _kill_coro_task(kill_internal()) {
   std::scoped_lock<std::mutex> lock{init_mutex};
 
-  // uses a shared asynchronous backend for all threads
-  if (shared_ring_fd == -1 || ring_instances == 0) {
-    int ret = io_uring_queue_init(queue_depth, &_ring, 0);
+  // enough for a full submission and completion queue before it has to grow
+  _request_table.reserve(queue_depth * 2);
+
+  io_uring_params params{};
+  if (_options.sq_poll) {
+    params.flags |= IORING_SETUP_SQPOLL;
+    params.sq_thread_idle = _options.sq_thread_idle_ms;
+    if (_options.sq_thread_cpu >= 0) {
+      params.flags |= IORING_SETUP_SQ_AFF;
+      params.sq_thread_cpu = _options.sq_thread_cpu;
+    }
+  }
+
+  if (_options.single_issuer || _options.defer_taskrun) {
+    params.flags |= IORING_SETUP_SINGLE_ISSUER;
+  }
+  if (_options.defer_taskrun) {
+    params.flags |= IORING_SETUP_DEFER_TASKRUN;
+  }
+  if (_options.coop_taskrun) {
+    params.flags |= IORING_SETUP_COOP_TASKRUN;
+  }
+  if (_options.taskrun_flag) {
+    params.flags |= IORING_SETUP_TASKRUN_FLAG;
+  }
+  if (_options.submit_all) {
+    params.flags |= IORING_SETUP_SUBMIT_ALL;
+  }
+  if (_options.cq_entries != 0) {
+    params.flags |= IORING_SETUP_CQSIZE;
+    params.cq_entries = _options.cq_entries;
+  }
+
+  // by default uses a shared asynchronous backend for all threads, apart from SQPOLL rings, since attaching
+  // those would also share the polling thread, which fails unless the shared ring has one
+  const bool process_shared = _options.work_queue_mode == WorkQueueMode::PROCESS_SHARED;
+  bool is_first_ring = process_shared && (shared_ring_fd == -1 || ring_instances == 0);
+  int wq_fd = -1;
+  if (process_shared && !is_first_ring) {
+    wq_fd = shared_ring_fd;
+  } else if (_options.work_queue_mode == WorkQueueMode::ATTACH) {
+    wq_fd = _options.attach_wq_fd;
+  }
+
+  if (wq_fd >= 0 && !_options.sq_poll) {
+    params.wq_fd = wq_fd;
+    params.flags |= IORING_SETUP_ATTACH_WQ;
+  }
+
+  int ret = io_uring_queue_init_params(queue_depth, &_ring, &params);
+  if (ret < 0) {
+    errno = -ret;
+    perror("The IO ring was unable to be setup properly");
+    _manager_life_state = LivingState::DEAD;
+    return;
+  }
+
+  if (_options.register_ring_fd) {
+    ret = io_uring_register_ring_fd(&_ring);
     if (ret < 0) {
-      perror("The IO ring was unable to setup properly (initial _ring for "
-             "sharing)");
-      perror("The IO ring was unable to be setup properly");
-      _manager_life_state = LivingState::DEAD;
-      return;
+      // not fatal, io_uring_enter just keeps looking the fd up
+      std::cerr << "Unable to register the ring fd: " << strerror(-ret) << "\n";
+    }
+  }
+
+  if (_options.polled_queue_depth != 0) {
+    io_uring_params polled_params{};
+    polled_params.flags = IORING_SETUP_IOPOLL | IORING_SETUP_ATTACH_WQ;
+    polled_params.wq_fd = _ring.ring_fd;
+    if (_options.single_issuer || _options.defer_taskrun) {
+      polled_params.flags |= IORING_SETUP_SINGLE_ISSUER;
     }
 
-    shared_ring_fd = _ring.ring_fd;
-  } else {
-    io_uring_params params{};
-    params.wq_fd = shared_ring_fd;
-    params.flags = IORING_SETUP_ATTACH_WQ;
-    int ret = io_uring_queue_init_params(queue_depth, &_ring, &params);
+    ret = io_uring_queue_init_params(_options.polled_queue_depth, &_polled_ring, &polled_params);
     if (ret < 0) {
-      perror("The IO _ring was unable to be setup properly");
-      _manager_life_state = LivingState::DEAD;
-      return;
+      // not fatal, the polled operations just fail to be queued
+      std::cerr << "Unable to setup the IOPOLL ring: " << strerror(-ret) << "\n";
+    } else {
+      _has_polled_ring = true;
+    }
+  }
+
+  if (_options.io_wq_bounded_workers != 0 || _options.io_wq_unbounded_workers != 0) {
+    ret = set_io_wq_limits(_options.io_wq_bounded_workers, _options.io_wq_unbounded_workers);
+    if (ret < 0) {
+      // not fatal, the kernel's defaults just stay in place
+      std::cerr << "Unable to set the io-wq worker limits: " << strerror(-ret) << "\n";
     }
   }
+  if (!_options.io_wq_cpus.empty()) {
+    ret = set_io_wq_affinity(_options.io_wq_cpus);
+    if (ret < 0) {
+      std::cerr << "Unable to set the io-wq CPU affinity: " << strerror(-ret) << "\n";
+    }
+  }
+
+  _inbox_fd = eventfd(0, EFD_CLOEXEC);
+  if (_inbox_fd < 0) {
+    // not fatal, the inbox is still drained whenever the loop wakes up for anything else
+    perror("Unable to make the inbox eventfd");
+  }
+
+  if (is_first_ring) {
+    shared_ring_fd = _ring.ring_fd;
+  }
 
   ring_instances++;
+  _open_to_posts.store(true);
+}
+
+EventManager::~EventManager() {
+  if (_inbox_fd >= 0) {
+    ::close(_inbox_fd);
+  }
 }
 
 /*
@@ -136,6 +307,7 @@ EvTask EventManager::kill_internal() {
   }
 
   io_uring_prep_cancel(sqe, nullptr, IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL);
+  io_uring_sqe_set_data64(sqe, 0);  // the slot may still hold user data from an earlier request
 
   iter = 0;
   while (_ring.sq.sqe_tail - _ring.sq.sqe_head != 0 && iter++ < MAX_ITER) {
@@ -148,18 +320,38 @@ EvTask EventManager::kill_internal() {
     co_return -1;
   }
 
-  // while there are still in flight requests we do not proceed
-  while (_in_flight_requests != 0) {
+  // while there are still in flight requests we do not proceed, polled file I/O can't be
+  // cancelled but completes quickly, and the loop keeps reaping it
+  while (_in_flight_requests != 0 || polling_files() || !_run_queue.empty() || _stealable.size() != 0 ||
+         _offloads_in_flight != 0) {
     co_await std::suspend_always{};
   }
 
   _manager_life_state = LivingState::DEAD;
 
+  if (_has_polled_ring) {
+    io_uring_queue_exit(&_polled_ring);
+    _has_polled_ring = false;
+  }
+  close_to_posts();
+
+  // buffer rings, registered buffers and direct files are unregistered while the ring is still around,
+  // buffers given back to a ring later are dropped
+  for (auto& buffers : _buffer_rings) {
+    buffers->unregister();
+  }
+  _fixed_buffers.unregister();
+  _fixed_files.unregister();
+
+  std::scoped_lock<std::mutex> lock{init_mutex};
+  if (shared_ring_fd == _ring.ring_fd) {
+    // reset it since it no longer refers to a valid ring, the next ring made takes its place
+    shared_ring_fd = -1;
+  }
   io_uring_queue_exit(&_ring);
   ring_instances--;
 
   if (ring_instances == 0) {
-    // reset it since it no longer refers to a valid _ring
     shared_ring_fd = -1;
   }
 
@@ -181,6 +373,10 @@ void EventManager::event_handler(int res, RequestData* req_data) {
     return;
   }
 
+  // req_data may live in the frame of the coroutine being resumed, which can be freed
+  // during resumption, so take what we need afterwards before resuming it
+  const bool pooled = req_data->pooled;
+
   auto& promise = req_data->handle.promise();
   auto& specific_data = req_data->specific_data;
 
@@ -219,6 +415,9 @@ void EventManager::event_handler(int res, RequestData* req_data) {
   }
   case RequestType::CLOSE: {
     CloseResponsePack data{};
+    if (specific_data.close_data.direct && res >= 0) {
+      _fixed_files.slot_emptied(static_cast<unsigned>(specific_data.close_data.fd));
+    }
     data.error_num = error_num;
     data.req_fd = specific_data.close_data.fd;
     promise.publish_resp_data<RequestType::CLOSE>(std::move(data));
@@ -263,7 +462,11 @@ void EventManager::event_handler(int res, RequestData* req_data) {
     AcceptResponsePack data{};
     if (res >= 0) {
       data = {.fd = res};
+      if (specific_data.accept_data.direct) {
+        _fixed_files.slot_filled();
+      }
     }
+    data.direct = specific_data.accept_data.direct;
     data.error_num = error_num;
     data.req_fd = specific_data.accept_data.sockfd;
     promise.publish_resp_data<RequestType::ACCEPT>(std::move(data));
@@ -280,6 +483,10 @@ void EventManager::event_handler(int res, RequestData* req_data) {
   }
   case RequestType::OPENAT: {
     OpenatResponsePack data{};
+    if (specific_data.openat_data.direct && res >= 0) {
+      _fixed_files.slot_filled();
+    }
+    data.direct = specific_data.openat_data.direct;
     data.error_num = error_num;
     data.req_fd = res;
     promise.publish_resp_data<RequestType::OPENAT>(std::move(data));
@@ -314,18 +521,83 @@ void EventManager::event_handler(int res, RequestData* req_data) {
     req_data->handle.resume();
     break;
   }
-  }
+  case RequestType::MSG_RING: {
+    // once posted the other ring owns the task, otherwise it's destroyed without ever running
+    if (res < 0) {
+      delete specific_data.msg_ring_data.task;
+    }
+    specific_data.msg_ring_data.task = nullptr;
 
-  // since the tasks final_suspend returns std::suspend_never
-  // then req_data->handle.done() is undefined (as handle.done() is only
-  // valid for suspended coroutines), so we use our own flags
-  if (!req_data->handle || promise.is_done()) {
-    // free the index if the coroutine has finished
-    _managed_coroutines_store.erase(req_data->coro_idx);
+    MsgRingResponsePack data{};
+    data.error_num = error_num;
+    data.req_fd = specific_data.msg_ring_data.ring_fd;
+    promise.publish_resp_data<RequestType::MSG_RING>(std::move(data));
+    req_data->handle.resume();
+    break;
+  }
+  case RequestType::RECV_PROVIDED: {
+    auto& recv_provided_data = specific_data.recv_provided_data;
+    ReadResponsePack data{};
+    if (req_data->cqe_flags & IORING_CQE_F_BUFFER) {
+      // the kernel took this buffer out of the ring, so it's out of use until the coroutine gives it back
+      const auto id = static_cast<uint16_t>(req_data->cqe_flags >> IORING_CQE_BUFFER_SHIFT);
+      recv_provided_data.buffers->mark_taken();
+      data.buffer_id = id;
+      data.buff = recv_provided_data.buffers->buffer(id);
+    }
+    if (res >= 0) {
+      data.bytes_read = static_cast<size_t>(res);
+    }
+    data.error_num = error_num;
+    data.req_fd = recv_provided_data.sockfd;
+    promise.publish_resp_data<RequestType::RECV_PROVIDED>(std::move(data));
+    req_data->handle.resume();
+    break;
+  }
+  case RequestType::READ_FIXED: {
+    ReadResponsePack data{};
+    if (res >= 0) {
+      data.bytes_read = static_cast<size_t>(res);
+      data.buff = specific_data.read_fixed_data.buffer;
+    }
+    data.error_num = error_num;
+    data.req_fd = specific_data.read_fixed_data.fd;
+    promise.publish_resp_data<RequestType::READ_FIXED>(std::move(data));
+    req_data->handle.resume();
+    break;
+  }
+  case RequestType::WRITE_FIXED: {
+    WriteResponsePack data{};
+    if (res >= 0) {
+      data.bytes_wrote = static_cast<size_t>(res);
+    }
+    data.error_num = error_num;
+    data.req_fd = specific_data.write_fixed_data.fd;
+    promise.publish_resp_data<RequestType::WRITE_FIXED>(std::move(data));
+    req_data->handle.resume();
+    break;
+  }
+  case RequestType::SOCKET: {
+    SocketResponsePack data{};
+    if (res >= 0) {
+      data.fd = res;
+      if (specific_data.socket_data.direct) {
+        _fixed_files.slot_filled();
+      }
+    }
+    data.direct = specific_data.socket_data.direct;
+    data.error_num = error_num;
+    data.req_fd = -1;  // there's no fd until it's made
+    promise.publish_resp_data<RequestType::SOCKET>(std::move(data));
+    req_data->handle.resume();
+    break;
+  }
+  case RequestType::ACCEPT_MULTISHOT:
+    break;  // handed to its AcceptStream as they complete, see queue_completion
   }
 
-  if (req_data->allocated_dynamic) {
-    delete req_data;
+  if (pooled) {
+    release_request_data(req_data);
   }
 }
 
@@ -340,24 +612,867 @@ bool EventManager::should_restrict_usage() {
 int EventManager::submit_queued_entries() {
   // don't need to restrict usage of this since it won't change
   // how many entries are in the SQ, CQ or currently in use
-  auto ret = io_uring_submit(&_ring);
-  if (ret > 0) {
-    _in_flight_requests += ret;
+  return submit_entries(0);
+}
+
+int EventManager::submit_entries(unsigned wait_nr, bool get_events) {
+  // with SQPOLL the kernel thread consumes entries by itself, and io_uring_submit reports everything it
+  // has yet to consume (including entries we flushed before), so count what is being flushed right now
+  const unsigned num_unflushed = _ring.sq.sqe_tail - _ring.sq.sqe_head;
+  const bool sq_poll = _ring.flags & IORING_SETUP_SQPOLL;
+
+  // liburing wakes the polling thread up if it went idle, which is the only time a syscall is needed
+  if (sq_poll && (IO_URING_READ_ONCE(*_ring.sq.kflags) & IORING_SQ_NEED_WAKEUP)) {
+    _stats.sq_thread_wakeups++;
+  }
+
+  int ret = 0;
+  if (wait_nr != 0) {
+    ret = io_uring_submit_and_wait(&_ring, wait_nr);
+  } else if (get_events) {
+    ret = io_uring_submit_and_get_events(&_ring);
+  } else {
+    ret = io_uring_submit(&_ring);
+  }
+  _stats.submit_calls++;
+  if (ret < 0) {
+    return ret;
   }
+
+  if (sq_poll) {
+    ret = static_cast<int>(num_unflushed);
+  }
+  _in_flight_requests += ret;
   return ret;
 }
 
+int EventManager::wait_for_completions(bool have_queued) {
+  if (_options.wait_policy != WaitPolicy::BLOCK) {
+    // get everything queued in flight first, otherwise there would be nothing to spin for
+    if (have_queued) {
+      int ret = submit_entries(0);
+      if (ret < 0) {
+        return ret;
+      }
+      have_queued = false;
+    }
+
+    if (spin_for_completions()) {
+      _stats.spin_hits++;
+      return 0;
+    }
+  }
+
+  _stats.sleeps++;
+  if (have_queued) {
+    return submit_entries(1);
+  }
+
+  io_uring_cqe* cqe;
+  // a zero timeout would have the loop wake straight back up, busy spinning, so it blocks instead
+  if (_options.wait_policy == WaitPolicy::SPIN_THEN_TIMEOUT && _options.wait_timeout_us != 0) {
+    __kernel_timespec timeout{};
+    timeout.tv_sec = static_cast<int64_t>(_options.wait_timeout_us / 1'000'000);
+    timeout.tv_nsec = static_cast<long long>((_options.wait_timeout_us % 1'000'000) * 1000);
+    return io_uring_wait_cqe_timeout(&_ring, &cqe, &timeout);
+  }
+  return io_uring_wait_cqe(&_ring, &cqe);
+}
+
+bool EventManager::spin_for_completions() {
+  const auto spin_start = std::chrono::steady_clock::now();
+  const auto spin_budget = std::chrono::nanoseconds(_options.spin_budget_ns);
+
+  for (uint64_t iter = 0;; iter++) {
+    if (io_uring_cq_ready(&_ring) != 0) {
+      return true;
+    }
+
+    // DEFER_TASKRUN completions are only posted when asked for, so only do that when told there are some,
+    // still counting against the budget, since the flag can stay set without anything reaching the queue
+    if ((_ring.flags & IORING_SETUP_TASKRUN_FLAG) && deferred_completions_pending()) {
+      io_uring_get_events(&_ring);
+      if (io_uring_cq_ready(&_ring) != 0) {
+        return true;
+      }
+    }
+
+    if (_options.spin_budget_iterations != 0 && iter >= _options.spin_budget_iterations) {
+      break;
+    }
+    if (_options.spin_budget_ns != 0 && std::chrono::steady_clock::now() - spin_start >= spin_budget) {
+      break;
+    }
+    if (_options.spin_budget_iterations == 0 && _options.spin_budget_ns == 0) {
+      break;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+
+  return false;
+}
+
+bool EventManager::deferred_completions_pending() {
+  if (!(_ring.flags & IORING_SETUP_DEFER_TASKRUN)) {
+    return false;
+  }
+
+  // without TASKRUN_FLAG the kernel doesn't tell us, so assume there may be some
+  if (!(_ring.flags & IORING_SETUP_TASKRUN_FLAG)) {
+    return true;
+  }
+  return IO_URING_READ_ONCE(*_ring.sq.kflags) & IORING_SQ_TASKRUN;
+}
+
+bool EventManager::polling_files() {
+  return _has_polled_ring && (_polled_in_flight_requests != 0 || io_uring_sq_ready(&_polled_ring) != 0);
+}
+
+size_t EventManager::reap_polled_completions() {
+  if (!polling_files()) {
+    return 0;
+  }
+
+  // for IOPOLL rings entering the kernel to get events is what polls the device for completions
+  int ret = io_uring_submit_and_get_events(&_polled_ring);
+  if (ret < 0) {
+    if (ret != -EINTR && ret != -EAGAIN) {
+      errno = -ret;
+      perror("Polling for file completions failed");
+    }
+    return 0;
+  }
+  _polled_in_flight_requests += ret;
+
+  size_t processed = 0;
+  std::array<io_uring_cqe*, CQE_BATCH_SIZE> cqes{};
+  unsigned count = 0;
+  while ((count = io_uring_peek_batch_cqe(&_polled_ring, cqes.data(), cqes.size())) != 0) {
+    for (unsigned i = 0; i < count; i++) {
+      queue_completion(cqes[i]);
+    }
+
+    io_uring_cq_advance(&_polled_ring, count);
+    _polled_in_flight_requests -= count;
+    processed += count;
+  }
+
+  _stats.polled_cqes += processed;
+  return processed;
+}
+
 void EventManager::register_coro(EvTask&& coro) {
   coro.start();  // start it in case it hasn't been started yet
 
-  uint64_t selected_idx = _managed_coroutines_store.insert(std::move(coro));
+  // nothing would ever erase it if it finished without waiting on anything
+  if (coro.is_done()) {
+    return;
+  }
+
+  uint64_t selected_key = _managed_coroutines_store.insert(std::move(coro));
 
-  // we are storing the index in the vector as metadata
-  _managed_coroutines_store[selected_idx].set_coro_metadata(selected_idx);
+  // we are storing the key in the store as metadata
+  auto task = _managed_coroutines_store.get(selected_key);
+  task->set_coro_metadata(selected_key);
+  task->set_on_finished(&EventManager::task_finished, this);
+}
+
+void EventManager::task_finished(void* owner, uint64_t key) {
+  // however the task finished (a completion, the run queue, a posted resume or a nested task returning),
+  // it's only erased once the resume which finished it has returned
+  auto ev = static_cast<EventManager*>(owner);
+  if (current() == ev) {
+    ev->_finished_tasks.push_back(key);
+    return;
+  }
+  // finished while migrated to another loop, so its own loop lets go of it
+  ev->enqueue_call([key](EventManager* home) { home->_managed_coroutines_store.erase(key); });
+}
+
+void EventManager::erase_finished_tasks() {
+  for (auto key : _finished_tasks) {
+    _managed_coroutines_store.erase(key);
+  }
+  _finished_tasks.clear();
 }
 
 io_uring_sqe* EventManager::get_uring_sqe() {
   if (should_restrict_usage())
     return nullptr;
+
+  auto sqe = io_uring_get_sqe(&_ring);
+  if (sqe == nullptr && submissions_deferred() && _ring.sq.sqe_tail != _ring.sq.sqe_head) {
+    // the queue is full of deferred entries, so flush them early to make room
+    submit_queued_entries();
+    sqe = io_uring_get_sqe(&_ring);
+  }
+  if (sqe == nullptr && (_ring.flags & IORING_SETUP_SQPOLL)) {
+    // the polling thread hasn't caught up with what was already flushed, so wait for it to
+    io_uring_sqring_wait(&_ring);
+    sqe = io_uring_get_sqe(&_ring);
+  }
+  return sqe;
+}
+
+io_uring_sqe* EventManager::get_polled_sqe() {
+  if (should_restrict_usage())
+    return nullptr;
+
+  if (!_has_polled_ring) {
+    return nullptr;
+  }
+
+  auto sqe = io_uring_get_sqe(&_polled_ring);
+  if (sqe == nullptr) {
+    // the queue is full of entries waiting for the next tick, so flush them early to make room
+    int ret = io_uring_submit(&_polled_ring);
+    if (ret > 0) {
+      _polled_in_flight_requests += ret;
+    }
+    sqe = io_uring_get_sqe(&_polled_ring);
+  }
+  return sqe;
+}
+
+bool EventManager::can_queue_operation(bool polled) {
+  if (should_restrict_usage())
+    return false;
+
+  if (polled && !_has_polled_ring) {
+    std::cerr << "There is no IOPOLL ring, set EventManagerOptions::polled_queue_depth to use one\n";
+    return false;
+  }
+  return true;
+}
+
+io_uring_sqe* EventManager::try_get_sqe(bool polled) {
+  if (should_restrict_usage())
+    return nullptr;
+
+  // unlike get_uring_sqe (and get_polled_sqe) this never flushes or blocks to make room, the caller waits
+  // for an SQE instead, which the loop hands out after its next submit of that ring
+  if (polled) {
+    return _has_polled_ring ? io_uring_get_sqe(&_polled_ring) : nullptr;
+  }
   return io_uring_get_sqe(&_ring);
 }
+
+void EventManager::wait_for_sqe(SqeWaiter waiter) {
+  _stats.sqe_waits++;
+  _sqe_waiters.push_back(waiter);
+}
+
+void EventManager::forget_sqe_wait(void* awaitable) {
+  std::erase_if(_sqe_waiters, [awaitable](const SqeWaiter& waiter) { return waiter.awaitable == awaitable; });
+}
+
+void EventManager::admit_sqe_waiters() {
+  if (_sqe_waiters.empty()) {
+    return;
+  }
+
+  // nothing new is accepted once dying, so fail the waiters rather than leaving them suspended
+  if (_manager_life_state > LivingState::LIVING) {
+    auto waiters = std::move(_sqe_waiters);
+    _sqe_waiters.clear();
+    for (auto& waiter : waiters) {
+      waiter.admit(waiter.awaitable, nullptr);
+    }
+    return;
+  }
+
+  // make room by flushing what's queued, the admitted entries are then submitted before the loop waits
+  if (io_uring_sq_space_left(&_ring) == 0) {
+    submit_entries(0);
+  }
+
+  while (!_sqe_waiters.empty()) {
+    auto waiter = _sqe_waiters.front();
+    auto sqe = io_uring_get_sqe(waiter.polled ? &_polled_ring : &_ring);
+    if (sqe == nullptr) {
+      break;
+    }
+
+    _sqe_waiters.pop_front();
+    waiter.admit(waiter.awaitable, sqe);
+  }
+}
+
+void EventManager::schedule(std::coroutine_handle<> handle) {
+  _run_queue.push_back({.handle = handle});
+}
+
+YieldAwaitable EventManager::yield() {
+  return YieldAwaitable{this};
+}
+
+void YieldAwaitable::await_suspend(EvTask::Handle h) {
+  ev->schedule(h);
+}
+
+void EventManager::run_ready_coroutines() {
+  // only run what was ready when we started, so anything scheduled meanwhile (i.e yielding
+  // coroutines) waits for the next iteration, after new completions have been harvested
+  size_t budget = _run_queue.size() + _stealable.size();
+  if (_options.max_resumes_per_tick != 0) {
+    budget = std::min<size_t>(budget, _options.max_resumes_per_tick);
+  }
+  _stats.max_run_queue = std::max(_stats.max_run_queue, _run_queue.size());
+
+  for (; budget != 0 && !_run_queue.empty(); budget--) {
+    auto ready = _run_queue.front();
+    _run_queue.pop_front();
+    _stats.resumes++;
+
+    if (ready.handle) {
+      ready.handle.resume();
+    } else {
+      event_handler(ready.res, ready.req_data);
+    }
+  }
+
+  // then whichever migratable coroutines no other loop has taken, most recently pushed first
+  for (; budget != 0; budget--) {
+    auto handle = _stealable.pop();
+    if (!handle) {
+      break;
+    }
+    _stats.resumes++;
+    handle.resume();
+  }
+}
+
+RequestData* EventManager::acquire_request_data() {
+  if (_free_request_data.empty()) {
+    // grow by another chunk, whose addresses stay put since requests in flight point into it
+    auto& chunk = _request_data_chunks.emplace_back(
+        std::make_unique<RequestData[]>(_request_data_chunk_size));
+    _free_request_data.reserve(_request_data_chunks.size() * _request_data_chunk_size);
+    for (size_t i = _request_data_chunk_size; i != 0; i--) {
+      _free_request_data.push_back(&chunk[i - 1]);
+    }
+  }
+
+  auto req_data = _free_request_data.back();
+  _free_request_data.pop_back();
+
+  *req_data = RequestData{};
+  req_data->pooled = true;
+  return req_data;
+}
+
+void EventManager::release_request_data(RequestData* req_data) {
+  _free_request_data.push_back(req_data);
+}
+
+uint64_t EventManager::register_request(RequestData* req_data) {
+  return _request_table.insert(req_data);
+}
+
+void EventManager::forget_request(uint64_t user_data) {
+  auto req_data = _request_table.resolve(user_data);
+  if (req_data == nullptr) {
+    return;  // already completed (or forgotten)
+  }
+
+  // a recv which may have taken a provided buffer, or an accept which may still hand out connections,
+  // keeps its entry, pointing at an orphan instead which puts the buffer back in its ring, or closes
+  // the connection, once the completion arrives, since the kernel won't
+  const auto kind = req_data->req_type;
+  if (kind == RequestType::RECV_PROVIDED || kind == RequestType::ACCEPT_MULTISHOT) {
+    auto orphan = acquire_request_data();
+    orphan->req_type = req_data->req_type;
+    orphan->specific_data = req_data->specific_data;
+    if (orphan->req_type == RequestType::ACCEPT_MULTISHOT) {
+      orphan->specific_data.accept_multishot_data.stream = nullptr;  // about to go away
+    }
+    orphan->orphaned = true;
+    _request_table.replace(user_data, orphan);
+    return;
+  }
+
+  _request_table.release(user_data);
+}
+
+void EventManager::queue_completion(const io_uring_cqe* cqe) {
+  const auto user_data = io_uring_cqe_get_data64(cqe);
+  if (user_data == 0) {
+    return;  // nothing to process for requests with no data
+  }
+
+  if (user_data == RequestTable::INBOX_READ_USER_DATA) {
+    // the inbox itself is drained every iteration anyway, this just got the loop out of waiting
+    _inbox_read_armed = false;
+    if (cqe->res < 0 && cqe->res != -ECANCELED) {
+      std::cerr << "Reading the inbox eventfd failed: " << strerror(-cqe->res) << "\n";
+    }
+    return;
+  }
+
+  // requests which post more than one completion keep their entry until the last of them
+  auto req_data = (cqe->flags & IORING_CQE_F_MORE) ? _request_table.resolve(user_data)
+                                                   : _request_table.release(user_data);
+  if (req_data == nullptr) {
+    _stats.stale_cqes++;
+    return;
+  }
+
+  req_data->cqe_flags = cqe->flags;
+  if (req_data->orphaned) {
+    _stats.stale_cqes++;
+    handle_orphan(cqe, req_data);
+    return;
+  }
+  if (req_data->req_type == RequestType::ACCEPT_MULTISHOT) {
+    // straight to the stream, which holds on to what's accepted until its coroutine asks for it
+    req_data->specific_data.accept_multishot_data.stream->handle_completion(cqe->res, cqe->flags);
+    return;
+  }
+  _run_queue.push_back({.res = cqe->res, .req_data = req_data});
+}
+
+void EventManager::handle_orphan(const io_uring_cqe* cqe, RequestData* orphan) {
+  if (orphan->req_type == RequestType::RECV_PROVIDED && (cqe->flags & IORING_CQE_F_BUFFER)) {
+    auto buffers = orphan->specific_data.recv_provided_data.buffers;
+    buffers->mark_taken();  // nobody claimed it, so count it as taken before it's given back
+    buffers->recycle(static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+  }
+  if (orphan->req_type == RequestType::ACCEPT_MULTISHOT && cqe->res >= 0) {
+    // a connection accepted after its stream went away, which nobody else would close
+    if (!orphan->specific_data.accept_multishot_data.direct) {
+      ::close(cqe->res);
+    } else if (auto sqe = get_uring_sqe(); sqe != nullptr) {
+      io_uring_prep_close_direct(sqe, static_cast<unsigned>(cqe->res));
+      io_uring_sqe_set_data64(sqe, 0);
+      _fixed_files.slot_filled();
+      _fixed_files.slot_emptied(static_cast<unsigned>(cqe->res));
+    } else {
+      _fixed_files.slot_filled();  // still taken, since there's no SQE to close it with
+      std::cerr << "Unable to close direct file table slot " << cqe->res << ", it stays in use\n";
+    }
+  }
+
+  if (!(cqe->flags & IORING_CQE_F_MORE)) {
+    release_request_data(orphan);
+  }
+}
+
+void EventManager::receive_posted(const io_uring_cqe* cqe) {
+  const auto user_data = io_uring_cqe_get_data64(cqe);
+  const auto payload = RequestTable::posted_payload(user_data);
+  _stats.posted_received++;
+
+  switch (RequestTable::posted_kind(user_data)) {
+  case RequestTable::PostedKind::TASK:
+    _posted_tasks.emplace_back(reinterpret_cast<EvTask*>(payload));
+    return;
+  case RequestTable::PostedKind::RESUME:
+    schedule(std::coroutine_handle<>::from_address(reinterpret_cast<void*>(payload)));
+    return;
+  case RequestTable::PostedKind::WAKEUP:
+    return;  // only sent to get the loop out of waiting, so it looks for work to steal
+  case RequestTable::PostedKind::MESSAGE:
+    break;
+  }
+
+  PostedMessage message{.data = payload, .value = cqe->res};
+  if (!_message_waiters.empty()) {
+    auto waiter = _message_waiters.front();
+    _message_waiters.pop_front();
+    waiter->waiting = false;
+    waiter->message = message;
+    schedule(waiter->handle);
+    return;
+  }
+
+  if (_message_handler) {
+    _message_handler(this, message);
+  } else {
+    _pending_messages.push_back(message);
+  }
+}
+
+void EventManager::start_posted_tasks() {
+  if (_posted_tasks.empty()) {
+    return;
+  }
+
+  auto tasks = std::move(_posted_tasks);
+  _posted_tasks.clear();
+  for (auto& task : tasks) {
+    register_coro(std::move(*task));
+  }
+}
+
+bool EventManager::post_to_ring(int ring_fd, uint64_t user_data) {
+  auto sqe = get_uring_sqe();
+  if (sqe == nullptr) {
+    submit_queued_entries();
+    sqe = get_uring_sqe();
+  }
+  if (sqe == nullptr) {
+    std::cerr << "Unable to get an SQE to post to another ring\n";
+    return false;
+  }
+
+  io_uring_prep_msg_ring(sqe, ring_fd, 0, user_data, 0);
+  io_uring_sqe_set_data64(sqe, 0);  // nothing is waiting on this side
+
+  if (!submissions_deferred()) {
+    submit_queued_entries();
+  }
+  return true;
+}
+
+bool EventManager::post_to(EventManager* target, uint64_t user_data) {
+  if (!begin_post(target)) {
+    return false;
+  }
+  const bool posted = post_to_ring(target->ring_fd(), user_data);
+  if (posted && submissions_deferred()) {
+    submit_queued_entries();  // the target's fd is only looked up on submission, so don't leave it queued
+  }
+  end_post(target);
+  return posted;
+}
+
+bool EventManager::begin_post(EventManager* target) {
+  // announce the post before checking, so close_to_posts either sees it in progress or we see it closed
+  target->_posts_in_progress.fetch_add(1);
+  if (!target->_open_to_posts.load()) {
+    target->_posts_in_progress.fetch_sub(1);
+    return false;
+  }
+  return true;
+}
+
+void EventManager::end_post(EventManager* target) {
+  target->_posts_in_progress.fetch_sub(1);
+}
+
+void EventManager::close_to_posts() {
+  _open_to_posts.store(false);
+  while (_posts_in_progress.load() != 0) {
+    std::this_thread::yield();
+  }
+}
+
+void EventManager::join_work_stealing(WorkStealingGroup* group) {
+  if (_manager_life_state != LivingState::NOT_STARTED) {
+    std::cerr << "Work stealing groups have to be joined before the event manager is started\n";
+    return;
+  }
+  if (!group->add(this)) {
+    std::cerr << "The work stealing group is already full\n";
+    return;
+  }
+  _stealing_group = group;
+}
+
+MigratableYieldAwaitable EventManager::yield_migratable() {
+  return MigratableYieldAwaitable{this};
+}
+
+ReturnHomeAwaitable EventManager::return_home() {
+  return ReturnHomeAwaitable{this};
+}
+
+EventManager* EventManager::current() {
+  return running_manager;
+}
+
+void EventManager::schedule_migratable(std::coroutine_handle<> handle) {
+  if (_stealing_group == nullptr) {
+    schedule(handle);  // nobody to share it with, so it's just a yield
+    return;
+  }
+
+  _stealable.push(handle);
+  wake_idle_peer();
+}
+
+bool EventManager::resume_on(EventManager* home, std::coroutine_handle<> handle) {
+  auto address = reinterpret_cast<uintptr_t>(handle.address());
+  return post_to(home, RequestTable::make_posted(RequestTable::PostedKind::RESUME, address));
+}
+
+bool EventManager::steal_ready_work() {
+  if (_stealing_group == nullptr || _manager_life_state != LivingState::LIVING) {
+    return false;
+  }
+
+  // flag ourselves idle before looking, so that a peer which pushes work after we've looked wakes us up
+  _idle.store(true);
+
+  const auto num_members = _stealing_group->size();
+  for (size_t i = 0; i < num_members; i++) {
+    auto idx = (_next_victim + i) % num_members;
+    auto peer = _stealing_group->member(idx);
+    if (peer == nullptr || peer == this) {
+      continue;
+    }
+
+    auto handle = peer->_stealable.steal();
+    if (handle) {
+      _next_victim = idx;  // try the same loop first next time, since it had work to spare
+      _idle.store(false);
+      _stats.steals++;
+      schedule(handle);
+      return true;
+    }
+  }
+  return false;
+}
+
+void EventManager::wake_idle_peer() {
+  // pairs with the fence in stealing, so either the peer sees our work or we see that it's idle
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  const auto num_members = _stealing_group->size();
+  for (size_t i = 0; i < num_members; i++) {
+    // members stay in the group once their loop is killed, but they're closed to posts by then
+    auto peer = _stealing_group->member(i);
+    if (peer == nullptr || peer == this || !peer->_open_to_posts.load()) {
+      continue;
+    }
+    if (peer->_idle.exchange(false) &&
+        post_to(peer, RequestTable::make_posted(RequestTable::PostedKind::WAKEUP, 0))) {
+      return;
+    }
+  }
+}
+
+void MigratableYieldAwaitable::await_suspend(EvTask::Handle h) {
+  ev->schedule_migratable(h);
+}
+
+bool ReturnHomeAwaitable::await_ready() const noexcept {
+  return EventManager::current() == ev;
+}
+
+bool ReturnHomeAwaitable::await_suspend(EvTask::Handle h) {
+  auto here = EventManager::current();
+  if (here == nullptr || !here->resume_on(ev, h)) {
+    std::cerr << "Unable to return the coroutine to its home loop\n";
+    return false;  // carry on where it is rather than being lost
+  }
+  return true;
+}
+
+void EventManager::arm_inbox_read() {
+  auto sqe = io_uring_get_sqe(&_ring);
+  if (sqe == nullptr) {
+    return;  // tried again next iteration, which doesn't block until it's armed
+  }
+
+  io_uring_prep_read(sqe, _inbox_fd, &_inbox_count, sizeof(_inbox_count), 0);
+  io_uring_sqe_set_data64(sqe, RequestTable::INBOX_READ_USER_DATA);
+  _inbox_read_armed = true;
+}
+
+void EventManager::drain_inbox() {
+  auto item = _inbox.take_all();
+  while (item != nullptr) {
+    std::unique_ptr<InboxItem> owned{std::exchange(item, item->next)};
+    if (owned->call) {
+      owned->call(this);
+    } else if (owned->task.has_value()) {
+      register_coro(std::move(owned->task.value()));
+    }
+  }
+}
+
+void EventManager::enqueue(InboxItem* item) {
+  if (!_inbox.push(item)) {
+    return;  // whoever made it non empty has already woken the loop up
+  }
+
+  // a thread running another loop can post to our ring, which saves a syscall when deferring, but
+  // nobody else is going to wake us up, so if the post fails (no SQE) fall back to the eventfd
+  auto here = EventManager::current();
+  if (here != nullptr && here != this &&
+      here->post_to(this, RequestTable::make_posted(RequestTable::PostedKind::WAKEUP, 0))) {
+    return;
+  }
+
+  uint64_t one = 1;
+  if (_inbox_fd >= 0 && ::write(_inbox_fd, &one, sizeof(one)) != sizeof(one)) {
+    perror("Unable to wake the event loop up");
+  }
+}
+
+void EventManager::enqueue_task(EvTask&& task) {
+  enqueue(new InboxItem{.task = std::move(task)});
+}
+
+void EventManager::enqueue_call(std::function<void(EventManager*)> call) {
+  enqueue(new InboxItem{.call = std::move(call)});
+}
+
+ProvidedBufferRing* EventManager::setup_buffer_ring(uint16_t group_id, uint32_t num_buffers,
+                                                     uint32_t buffer_size) {
+  const bool power_of_two = num_buffers != 0 && (num_buffers & (num_buffers - 1)) == 0;
+  if (!power_of_two || num_buffers > 32768 || buffer_size == 0) {
+    std::cerr << "Buffer rings need a power of two number of buffers (up to 32768) which aren't empty\n";
+    return nullptr;
+  }
+  if (buffer_ring(group_id) != nullptr) {
+    std::cerr << "There's already a buffer ring for group " << group_id << "\n";
+    return nullptr;
+  }
+
+  int ret = 0;
+  auto buf_ring = io_uring_setup_buf_ring(&_ring, num_buffers, group_id, 0, &ret);
+  if (buf_ring == nullptr) {
+    std::cerr << "Unable to setup the buffer ring: " << strerror(-ret) << "\n";
+    return nullptr;
+  }
+
+  auto& buffers = _buffer_rings.emplace_back(
+      std::make_unique<ProvidedBufferRing>(&_ring, buf_ring, group_id, num_buffers, buffer_size));
+  return buffers.get();
+}
+
+ProvidedBufferRing* EventManager::buffer_ring(uint16_t group_id) {
+  for (auto& buffers : _buffer_rings) {
+    if (buffers->group_id() == group_id) {
+      return buffers.get();
+    }
+  }
+  return nullptr;
+}
+
+BufferArena* EventManager::setup_buffer_arena(size_t bytes, size_t slab_size) {
+  if (_buffer_arena != nullptr) {
+    std::cerr << "There's already a buffer arena\n";
+    return nullptr;
+  }
+
+  auto arena = std::make_unique<BufferArena>(bytes, slab_size);
+  if (!arena->mapped()) {
+    return nullptr;
+  }
+  _buffer_arena = std::move(arena);
+  return _buffer_arena.get();
+}
+
+int EventManager::set_io_wq_limits(unsigned bounded, unsigned unbounded) {
+  unsigned values[2] = {bounded, unbounded};
+  return io_uring_register_iowq_max_workers(&_ring, values);
+}
+
+int EventManager::set_io_wq_affinity(const std::vector<int>& cpus) {
+  if (cpus.empty()) {
+    return io_uring_unregister_iowq_aff(&_ring);
+  }
+
+  cpu_set_t cpu_set{};
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &cpu_set);
+  }
+  return io_uring_register_iowq_aff(&_ring, sizeof(cpu_set), &cpu_set);
+}
+
+IoWorkQueueStatus EventManager::io_wq_status() {
+  // limits of 0 don't change anything, but the kernel still reports what they are
+  unsigned values[2] = {0, 0};
+  if (io_uring_register_iowq_max_workers(&_ring, values) < 0) {
+    values[0] = values[1] = 0;
+  }
+  return {.bounded_limit = values[0], .unbounded_limit = values[1], .workers = count_io_wq_workers()};
+}
+
+size_t EventManager::count_io_wq_workers() {
+  auto dir = opendir("/proc/self/task");
+  if (dir == nullptr) {
+    return 0;
+  }
+
+  size_t workers = 0;
+  while (auto entry = readdir(dir)) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+
+    std::ifstream comm_file{std::string{"/proc/self/task/"} + entry->d_name + "/comm"};
+    std::string comm{};
+    if (std::getline(comm_file, comm) && comm.starts_with("iou-wrk-")) {
+      workers++;
+    }
+  }
+  closedir(dir);
+  return workers;
+}
+
+void EventManager::use_offload_pool(OffloadPool* pool) {
+  _offload_pool = pool;
+}
+
+bool EventManager::submit_offload(OffloadJob* job) {
+  if (should_restrict_usage())
+    return false;
+
+  if (_offload_pool == nullptr) {
+    _own_offload_pool = std::make_unique<OffloadPool>(_options.offload_threads);
+    _offload_pool = _own_offload_pool.get();
+  }
+
+  _offloads_in_flight++;
+  _offload_pool->submit(job);
+  return true;
+}
+
+void EventManager::finish_offload() {
+  _offloads_in_flight--;
+}
+
+void EventManager::set_message_handler(MessageHandler handler) {
+  _message_handler = std::move(handler);
+}
+
+ReceiveMessageAwaitable EventManager::receive_message() {
+  return ReceiveMessageAwaitable{this};
+}
+
+std::optional<PostedMessage> EventManager::take_message() {
+  if (_pending_messages.empty()) {
+    return std::nullopt;
+  }
+
+  auto message = _pending_messages.front();
+  _pending_messages.pop_front();
+  return message;
+}
+
+void EventManager::wait_for_message(ReceiveMessageAwaitable* waiter) {
+  waiter->waiting = true;
+  _message_waiters.push_back(waiter);
+}
+
+void EventManager::forget_message_wait(ReceiveMessageAwaitable* waiter) {
+  std::erase(_message_waiters, waiter);
+}
+
+ReceiveMessageAwaitable::~ReceiveMessageAwaitable() {
+  // destroyed while waiting (along with its coroutine), so no message may be handed to it later
+  if (waiting) {
+    ev->forget_message_wait(this);
+  }
+}
+
+bool ReceiveMessageAwaitable::await_ready() {
+  auto pending = ev->take_message();
+  if (pending.has_value()) {
+    message = pending.value();
+  }
+  return pending.has_value();
+}
+
+void ReceiveMessageAwaitable::await_suspend(EvTask::Handle h) {
+  handle = h;
+  ev->wait_for_message(this);
+}
@@ -1,58 +1,148 @@
 #ifndef EVENT_MANAGER_
 #define EVENT_MANAGER_
 
+#include <atomic>
+#include <coroutine>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <liburing.h>
 #include <liburing/io_uring.h>
 #include <mutex>
 #include <sys/socket.h>
 #include <sys/types.h>
-#include <unordered_set>
+#include <memory>
+#include <optional>
 #include <vector>
 
 #include "communication/communication_channel.hpp"
 #include "communication/communication_types.hpp"
 #include "coroutine/task.hpp"
 #include "errors.hpp"
+#include "event_loop/buffer_arena.hpp"
+#include "event_loop/buffer_ring.hpp"
+#include "event_loop/event_manager_options.hpp"
+#include "event_loop/fixed_buffers.hpp"
+#include "event_loop/fixed_files.hpp"
+#include "event_loop/inbox.hpp"
+#include "event_loop/iobuf.hpp"
+#include "event_loop/offload_pool.hpp"
 #include "event_loop/request_data.hpp"
+#include "event_loop/request_table.hpp"
+#include "event_loop/work_stealing.hpp"
 #include "parameter_packs.hpp"
 
+/*
+Slab of items addressed by keys, which hold the slot index in the low 32 bits and the slot's
+generation in the high 32 bits. Erasing an item destroys it straight away and bumps the slot's
+generation, so keys for it go stale rather than referring to whatever reuses the slot (key 0 is
+never valid). Free slots form an intrusive LIFO list, and slots are allocated in chunks which
+never move, so items keep their address for as long as they're stored
+*/
 template <typename T>
 class ItemStore {
-  std::vector<T> _items;
-  std::unordered_set<size_t> _freed_idxs{};
+  static constexpr size_t CHUNK_SIZE = 64;
+  static constexpr uint32_t NO_FREE_SLOT = UINT32_MAX;
+
+  struct Slot {
+    std::optional<T> item{};
+    uint32_t generation{1};
+    uint32_t next_free{NO_FREE_SLOT};
+  };
+
+  std::vector<std::unique_ptr<Slot[]>> _chunks{};
+  uint32_t _num_slots{};
+  uint32_t _free_head{NO_FREE_SLOT};
+  size_t _size{};
+
+  Slot& slot_at(uint32_t idx) {
+    return _chunks[idx / CHUNK_SIZE][idx % CHUNK_SIZE];
+  }
+
+  Slot* slot_for(uint64_t key) {
+    auto idx = static_cast<uint32_t>(key);
+    if (idx >= _num_slots) {
+      return nullptr;
+    }
+
+    auto& slot = slot_at(idx);
+    if (slot.generation != static_cast<uint32_t>(key >> 32) || !slot.item.has_value()) {
+      return nullptr;
+    }
+    return &slot;
+  }
 
 public:
-  ItemStore() : _items{} {};
-
-  size_t insert(T&& item) {
-    size_t selected_idx = 0;
-    if (_freed_idxs.size() != 0) {
-      selected_idx = *_freed_idxs.begin();
-      _freed_idxs.erase(selected_idx);
-      _items[selected_idx] = std::move(item);
-    } else {
-      _items.push_back(std::move(item));
-      selected_idx = _items.size() - 1;
+  uint64_t insert(T&& item) {
+    if (_free_head == NO_FREE_SLOT) {
+      // grow by a whole chunk, threading its slots onto the free list in order
+      _chunks.push_back(std::make_unique<Slot[]>(CHUNK_SIZE));
+      for (size_t i = CHUNK_SIZE; i != 0; i--) {
+        auto idx = static_cast<uint32_t>(_num_slots + i - 1);
+        slot_at(idx).next_free = _free_head;
+        _free_head = idx;
+      }
+      _num_slots += CHUNK_SIZE;
+    }
+
+    auto idx = _free_head;
+    auto& slot = slot_at(idx);
+    _free_head = slot.next_free;
+    slot.next_free = NO_FREE_SLOT;
+    slot.item.emplace(std::move(item));
+    _size++;
+
+    return (static_cast<uint64_t>(slot.generation) << 32) | idx;
+  }
+
+  // nullptr if the key is stale or was never valid
+  T* get(uint64_t key) {
+    auto slot = slot_for(key);
+    return slot == nullptr ? nullptr : &slot->item.value();
+  }
+
+  // returns false if the key is stale, so erasing twice is harmless
+  bool erase(uint64_t key) {
+    auto slot = slot_for(key);
+    if (slot == nullptr) {
+      return false;
+    }
+
+    auto idx = static_cast<uint32_t>(key);
+    slot->item.reset();
+    slot->generation++;
+    if (slot->generation == 0) {
+      slot->generation = 1;  // keep key 0 invalid when the generation wraps around
     }
-    return selected_idx;
+    slot->next_free = _free_head;
+    _free_head = idx;
+    _size--;
+    return true;
   }
 
-  T& operator[](size_t idx) {
-    return _items[idx];
+  // number of items currently stored
+  size_t size() const {
+    return _size;
   }
 
-  void erase(size_t idx) {
-    _freed_idxs.insert(idx);
+  size_t capacity() const {
+    return _num_slots;
   }
 };
 
 class EventManager;
 enum class PollingState { CONTINUE_POLLING, STOP_POLLING };
 
+// a message another event manager posted to this one's ring with post_message
+struct PostedMessage {
+  uint64_t data{};
+  int32_t value{};
+};
+
 using SubmitAndWaitHandler = std::function<void(RequestType, CommunicationChannel*)>;
 using PollHandler = std::function<PollingState(EventManager*, RequestType, CommunicationChannel*)>;
+using MessageHandler = std::function<void(EventManager*, PostedMessage)>;
 
 // forward declare the awaitable return types and request data
 struct RequestData;
@@ -68,6 +158,48 @@ struct OpenatAwaitable;
 struct StatxAwaitable;
 struct UnlinkatAwaitable;
 struct RenameatAwaitable;
+struct MsgRingAwaitable;
+struct RecvProvidedAwaitable;
+struct ReadFixedAwaitable;
+struct WriteFixedAwaitable;
+struct SocketAwaitable;
+template <typename Fn>
+struct OffloadAwaitable;
+
+// an awaitable which found the submission queue full, they're handed SQEs in the order they started
+// waiting once the queue has room again (or nullptr if the event manager won't take any more operations)
+struct SqeWaiter {
+  void* awaitable{};
+  bool polled{};
+  void (*admit)(void* awaitable, io_uring_sqe* sqe){};
+};
+
+// io-wq limits are per ring, while the worker count is for the whole process, since it comes from
+// counting the kernel's iou-wrk threads
+struct IoWorkQueueStatus {
+  unsigned bounded_limit{};
+  unsigned unbounded_limit{};
+  size_t workers{};
+};
+
+// counters describing how the event loop has been processing completions
+struct EventLoopStats {
+  uint64_t wakeups{};            // number of times the loop harvested the completion queue
+  uint64_t cqes_processed{};     // total number of CQEs handled across all wakeups
+  size_t last_batch_size{};      // CQEs handled in the most recent wakeup
+  size_t max_batch_size{};       // most CQEs handled in a single wakeup
+  uint64_t submit_calls{};       // number of times queued entries were submitted to the kernel
+  uint64_t sq_thread_wakeups{};  // times an idle SQPOLL thread had to be woken up (which needs a syscall)
+  uint64_t spin_hits{};          // times a completion arrived while spinning, so the loop didn't sleep
+  uint64_t sleeps{};             // times the loop blocked in the kernel waiting for completions
+  uint64_t polled_cqes{};        // CQEs reaped from the IOPOLL ring
+  uint64_t sqe_waits{};          // operations which had to wait for a free SQE
+  uint64_t stale_cqes{};         // completions ignored since their request was already released or forgotten
+  uint64_t resumes{};            // coroutines resumed from the run queue
+  size_t max_run_queue{};        // longest the run queue has been at the start of an iteration
+  uint64_t posted_received{};    // completions posted to this ring by other event managers
+  uint64_t steals{};             // migratable coroutines taken from other loops in the work stealing group
+};
 
 struct GenericResponse {
   CommunicationChannel* channel{};
@@ -82,6 +214,51 @@ struct GenericResponse {
   }
 };
 
+// a completion (or a coroutine which yielded) waiting on the run queue to be resumed
+struct ReadyCoroutine {
+  int res{};
+  RequestData* req_data{};
+  std::coroutine_handle<> handle{};  // only set for coroutines which yielded
+};
+
+struct YieldAwaitable {
+  EventManager* ev{};
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(EvTask::Handle h);
+  void await_resume() const noexcept {}
+};
+
+struct MigratableYieldAwaitable {
+  EventManager* ev{};
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(EvTask::Handle h);
+  void await_resume() const noexcept {}
+};
+
+struct ReturnHomeAwaitable {
+  EventManager* ev{};
+  bool await_ready() const noexcept;  // already on the home loop's thread
+  bool await_suspend(EvTask::Handle h);
+  void await_resume() const noexcept {}
+};
+
+struct ReceiveMessageAwaitable {
+  EventManager* ev{};
+  PostedMessage message{};
+  EvTask::Handle handle{};
+  bool waiting{};  // on the event manager's message waiters
+  ~ReceiveMessageAwaitable();
+  bool await_ready();  // doesn't suspend if a message is already waiting
+  void await_suspend(EvTask::Handle h);
+  PostedMessage await_resume() const noexcept {
+    return message;
+  }
+};
+
 class EventManager {
   enum LivingState { NOT_STARTED, LIVING, DYING, DEAD };
   LivingState _manager_life_state{};
@@ -91,15 +268,103 @@ class EventManager {
   static size_t ring_instances;
 
   io_uring _ring{};
+  EventManagerOptions _options{};
+  // before anything which may hold IOBufs (i.e coroutine frames), so it's destroyed after them
+  IOBufPool _iobuf_pool{_options.iobuf_block_size};
+
+  // secondary IOPOLL ring for O_DIRECT file I/O, its completions are found by polling not interrupts
+  io_uring _polled_ring{};
+  bool _has_polled_ring{};
+  std::size_t _polled_in_flight_requests{};
 
   ItemStore<EvTask> _managed_coroutines_store{};
+  // keys of managed tasks which finished during this iteration, erased once nothing is running them
+  std::vector<uint64_t> _finished_tasks{};
+  static void task_finished(void* owner, uint64_t key);
+  void erase_finished_tasks();
 
   bool _polling_requests{};  // to prevent trying to poll within the polling context
   EvTask::Handle _polling_handle = nullptr;
   std::vector<std::pair<int, RequestData*>> _ready_requests_store{};
 
+  // request data for the _na operations, which grows a chunk (of the queue depth) at a time so that
+  // taking and giving back an entry is just popping and pushing a pointer
+  std::vector<std::unique_ptr<RequestData[]>> _request_data_chunks{};
+  std::vector<RequestData*> _free_request_data{};
+  size_t _request_data_chunk_size{};
+  RequestData* acquire_request_data();
+  void release_request_data(RequestData* req_data);
+
+  EventLoopStats _stats{};
+
+  std::deque<SqeWaiter> _sqe_waiters{};
+  void admit_sqe_waiters();
+
+  // coroutines are resumed from here after completions are harvested rather than from inside
+  // the harvesting, which keeps the loop's stack shallow and lets every coroutine get a turn
+  std::deque<ReadyCoroutine> _run_queue{};
+  void run_ready_coroutines();
+
+  // every SQE's user_data refers to an entry in here (see request_table.hpp)
+  RequestTable _request_table{};
+  void queue_completion(const io_uring_cqe* cqe);
+  void handle_orphan(const io_uring_cqe* cqe, RequestData* orphan);
+
+  // messages posted by other rings go to a waiting coroutine first, then the handler, and are
+  // otherwise kept until received, while posted tasks are started once the harvest is done
+  std::deque<PostedMessage> _pending_messages{};
+  std::deque<ReceiveMessageAwaitable*> _message_waiters{};
+  MessageHandler _message_handler{};
+  std::vector<std::unique_ptr<EvTask>> _posted_tasks{};
+  void receive_posted(const io_uring_cqe* cqe);
+  void start_posted_tasks();
+  bool post_to_ring(int ring_fd, uint64_t user_data);
+  // other loops only post to this ring while it's open, kill closes it (waiting out any post in progress)
+  // before the ring is torn down, so a post never lands on a closed (or reused) fd
+  std::atomic<bool> _open_to_posts{};
+  std::atomic<size_t> _posts_in_progress{};
+  bool post_to(EventManager* target, uint64_t user_data);
+  // held from preparing a post to target until it's submitted, false (and not held) if it's closed
+  bool begin_post(EventManager* target);
+  void end_post(EventManager* target);
+  void close_to_posts();
+
+  // migratable coroutines wait here rather than on the run queue, so idle loops in the group can take
+  // them, and a loop flags itself idle just before it would sleep so that others know to wake it up
+  WorkStealingGroup* _stealing_group{};
+  WorkStealingDeque _stealable{};
+  std::atomic<bool> _idle{};
+  size_t _next_victim{};
+  bool steal_ready_work();
+  void wake_idle_peer();
+
+  // other threads hand over work through the inbox, and wake the loop up by writing to an eventfd it
+  // always has a read armed on (or by posting to the ring, when they're running a loop themselves)
+  Inbox _inbox{};
+  int _inbox_fd{-1};
+  uint64_t _inbox_count{};
+  bool _inbox_read_armed{};
+  void arm_inbox_read();
+  void drain_inbox();
+  void enqueue(InboxItem* item);
+
+  std::vector<std::unique_ptr<ProvidedBufferRing>> _buffer_rings{};
+  std::unique_ptr<BufferArena> _buffer_arena{};  // before _fixed_buffers, which may have its slabs registered
+  FixedBufferTable _fixed_buffers{&_ring};
+  FixedFileTable _fixed_files{&_ring};
+
+  std::unique_ptr<OffloadPool> _own_offload_pool{};
+  OffloadPool* _offload_pool{};
+  size_t _offloads_in_flight{};
+
   void await_message();
   void event_handler(int res, RequestData* req_data);
+  int submit_entries(unsigned wait_nr, bool get_events = false);
+  bool deferred_completions_pending();
+  int wait_for_completions(bool have_queued);
+  bool spin_for_completions();
+  size_t reap_polled_completions();
+  bool polling_files();
 
   std::size_t _in_flight_requests{};
   bool should_restrict_usage();
@@ -108,8 +373,11 @@ class EventManager {
 
   Errnos submit_request(io_uring_sqe* sqe, RequestData* req_data);
   std::pair<io_uring_sqe*, RequestData*> get_sqe_and_req_data(RequestType req_type);
+  // user_data is set to the request's table entry once it's queued
   bool process_single_generic_request(const OperationParameterPackVariant& req, RequestData& single_req,
-                                      EvTask::Handle handle);
+                                      EvTask::Handle handle, uint64_t& user_data);
+  // false for read_fixed/write_fixed ranges which don't fit their registered buffer
+  bool fixed_range_valid(const OperationParameterPackVariant& req) const;
 
 public:
   EvTask kill();
@@ -124,14 +392,121 @@ public:
   // register a coroutine by moving in a previously constructed coroutine
   void register_coro(EvTask&& coro);
 
-  EventManager(size_t queue_depth);
+  EventManager(size_t queue_depth, EventManagerOptions options = {});
+  ~EventManager();
+  EventManager(const EventManager&) = delete;
+  EventManager& operator=(const EventManager&) = delete;
+
+  // safe to call from any thread, the task is started (or the call made) on the loop's thread
+  void enqueue_task(EvTask&& task);
+  void enqueue_call(std::function<void(EventManager*)> call);
 
   void start();
   int submit_queued_entries();
   io_uring_sqe* get_uring_sqe();
+  io_uring_sqe* get_polled_sqe();
+
+  // used by the awaitables, which wait on the SQE wait list rather than failing when the queue is full
+  bool can_queue_operation(bool polled);
+  io_uring_sqe* try_get_sqe(bool polled);
+  void wait_for_sqe(SqeWaiter waiter);
+  // for waiters which go away before they're handed an SQE
+  void forget_sqe_wait(void* awaitable);
+  bool sqe_waiters_pending() const {
+    return !_sqe_waiters.empty();
+  }
+
+  // returns the user_data to give the SQE, forgetting it makes any completion for it be ignored (apart
+  // from giving back what the kernel handed over with it, i.e a provided buffer)
+  uint64_t register_request(RequestData* req_data);
+  void forget_request(uint64_t user_data);
+
+  // resume the coroutine from the run queue, after everything which is already ready
+  void schedule(std::coroutine_handle<> handle);
+  // let every other ready coroutine run before continuing
+  [[nodiscard]] YieldAwaitable yield();
+
+  // cross ring messaging, the handler is called for messages no coroutine is waiting for
+  void set_message_handler(MessageHandler handler);
+  [[nodiscard]] ReceiveMessageAwaitable receive_message();
+  std::optional<PostedMessage> take_message();
+  void wait_for_message(ReceiveMessageAwaitable* waiter);
+  void forget_message_wait(ReceiveMessageAwaitable* waiter);
+
+  // work stealing, join the group before the loop is started
+  void join_work_stealing(WorkStealingGroup* group);
+  // like yield, but any loop in the group may resume it, so until it has returned home the coroutine
+  // must only do work which doesn't touch this event manager (or any other)
+  [[nodiscard]] MigratableYieldAwaitable yield_migratable();
+  [[nodiscard]] ReturnHomeAwaitable return_home();
+  void schedule_migratable(std::coroutine_handle<> handle);
+  // post the coroutine to another loop's ring for it to resume, from this loop's thread
+  bool resume_on(EventManager* home, std::coroutine_handle<> handle);
+  // the event manager whose loop is running on the calling thread, if any
+  static EventManager* current();
+
+  // io-wq controls, these return 0 or a negative errno (limits of 0 leave that limit as it was)
+  int set_io_wq_limits(unsigned bounded, unsigned unbounded);
+  int set_io_wq_affinity(const std::vector<int>& cpus);
+  IoWorkQueueStatus io_wq_status();
+  static size_t count_io_wq_workers();
+
+  // provided buffer rings for buffer select (see buffer_ring.hpp), num_buffers has to be a power of two
+  // (up to 32768), nullptr if it couldn't be set up, i.e the group id is already taken
+  ProvidedBufferRing* setup_buffer_ring(uint16_t group_id, uint32_t num_buffers, uint32_t buffer_size);
+  ProvidedBufferRing* buffer_ring(uint16_t group_id);
+  // one huge page backed arena of aligned slabs for large or O_DIRECT I/O (see buffer_arena.hpp), which
+  // can also be registered with fixed_buffers().setup_from_arena, nullptr if it couldn't be mapped or
+  // there already is one
+  BufferArena* setup_buffer_arena(size_t bytes, size_t slab_size);
+  BufferArena* buffer_arena() {
+    return _buffer_arena.get();
+  }
+  // registered buffers for read_fixed and write_fixed (see fixed_buffers.hpp)
+  FixedBufferTable& fixed_buffers() {
+    return _fixed_buffers;
+  }
+  // pooled, reference counted buffers (see iobuf.hpp), only for use on this loop's thread
+  IOBufPool& iobuf_pool() {
+    return _iobuf_pool;
+  }
+  IOBuf allocate_iobuf() {
+    return _iobuf_pool.allocate();
+  }
+  // the direct file table for FixedFile operations and the _direct variants (see fixed_files.hpp)
+  FixedFileTable& fixed_files() {
+    return _fixed_files;
+  }
+
+  // share a pool between event managers for offload(), the pool has to outlive this
+  void use_offload_pool(OffloadPool* pool);
+  // used by OffloadAwaitable, returns false if the job has to be run in place instead
+  bool submit_offload(OffloadJob* job);
+  void finish_offload();
+
+  int ring_fd() const {
+    return _ring.ring_fd;
+  }
+  bool submissions_deferred() const {
+    return _options.submission_mode == SubmissionMode::DEFERRED;
+  }
+  // tasks registered with register_coro which haven't finished yet
+  size_t managed_coroutines() const {
+    return _managed_coroutines_store.size();
+  }
+  const EventLoopStats& stats() const {
+    return _stats;
+  }
+  // how many chunks of request data the _na operations have needed so far
+  size_t request_data_chunks() const {
+    return _request_data_chunks.size();
+  }
 
   [[nodiscard]] ReadAwaitable read(int fd, uint8_t* buffer, size_t length);
   [[nodiscard]] WriteAwaitable write(int fd, const uint8_t* buffer, size_t length);
+  // O_DIRECT file I/O through the IOPOLL ring (see EventManagerOptions::polled_queue_depth)
+  [[nodiscard]] ReadAwaitable read_polled(int fd, uint8_t* buffer, size_t length, uint64_t offset);
+  [[nodiscard]] WriteAwaitable write_polled(int fd, const uint8_t* buffer, size_t length, uint64_t offset);
   [[nodiscard]] CloseAwaitable close(int fd);
   [[nodiscard]] ShutdownAwaitable shutdown(int fd, int how);
   [[nodiscard]] ReadvAwaitable readv(int fd, struct iovec* iovs, size_t num);
@@ -144,6 +519,49 @@ public:
   [[nodiscard]] UnlinkatAwaitable unlinkat(int dirfd, const char* pathname, int flags);
   [[nodiscard]] RenameatAwaitable renameat(int olddirfd, const char* oldpathname, int newdirfd,
                                            const char* newpathname, int flags);
+  // post a message (data must fit in 56 bits) or a task to another event manager's ring, the task
+  // runs on that event manager's thread, and is destroyed unstarted if it can't be posted
+  [[nodiscard]] MsgRingAwaitable post_message(EventManager* target, uint64_t data, int32_t value = 0);
+  [[nodiscard]] MsgRingAwaitable post_task(EventManager* target, EvTask&& task);
+  // recv into a buffer the kernel takes from the ring once data arrives, the response's buffer_id says
+  // which (the coroutine then has to give it back, i.e by claiming it), fails with ENOBUFS if it's empty
+  [[nodiscard]] RecvProvidedAwaitable recv_provided(int sockfd, ProvidedBufferRing* buffers, int flags = 0);
+  // read or write length bytes at buf_offset into registered buffer buf_index, which has to fit in it
+  [[nodiscard]] ReadFixedAwaitable read_fixed(int fd, unsigned buf_index, size_t buf_offset, size_t length,
+                                              uint64_t offset = 0);
+  [[nodiscard]] WriteFixedAwaitable write_fixed(int fd, unsigned buf_index, size_t buf_offset, size_t length,
+                                                uint64_t offset = 0);
+  [[nodiscard]] SocketAwaitable socket(int domain, int type, int protocol);
+  // readv into the chain's tailroom (commit the bytes read to it afterwards), or writev everything in it
+  // (consume the bytes written afterwards), the chain mustn't change until the operation completes
+  [[nodiscard]] ReadvAwaitable readv(int fd, IOBufChain& chain);
+  [[nodiscard]] WritevAwaitable writev(int fd, IOBufChain& chain);
+
+  // the same operations on a file in the direct file table
+  [[nodiscard]] ReadAwaitable read(FixedFile file, uint8_t* buffer, size_t length);
+  [[nodiscard]] WriteAwaitable write(FixedFile file, const uint8_t* buffer, size_t length);
+  [[nodiscard]] CloseAwaitable close(FixedFile file);
+  [[nodiscard]] ShutdownAwaitable shutdown(FixedFile file, int how);
+  [[nodiscard]] ReadvAwaitable readv(FixedFile file, struct iovec* iovs, size_t num);
+  [[nodiscard]] WritevAwaitable writev(FixedFile file, struct iovec* iovs, size_t num);
+  [[nodiscard]] AcceptAwaitable accept(FixedFile file, sockaddr* addr, socklen_t* addrlen);
+  [[nodiscard]] ConnectAwaitable connect(FixedFile file, const sockaddr* addr, socklen_t addrlen);
+  [[nodiscard]] RecvProvidedAwaitable recv_provided(FixedFile file, ProvidedBufferRing* buffers,
+                                                    int flags = 0);
+  [[nodiscard]] ReadFixedAwaitable read_fixed(FixedFile file, unsigned buf_index, size_t buf_offset,
+                                              size_t length, uint64_t offset = 0);
+  [[nodiscard]] WriteFixedAwaitable write_fixed(FixedFile file, unsigned buf_index, size_t buf_offset,
+                                                size_t length, uint64_t offset = 0);
+  // these put what they make straight into a free slot of the direct file table rather than returning an
+  // fd, the slot's index is the response's fd (req_fd for openat_direct), which is then used as a FixedFile
+  [[nodiscard]] AcceptAwaitable accept_direct(int sockfd, sockaddr* addr, socklen_t* addrlen);
+  [[nodiscard]] AcceptAwaitable accept_direct(FixedFile file, sockaddr* addr, socklen_t* addrlen);
+  [[nodiscard]] OpenatAwaitable openat_direct(int dirfd, const char* pathname, int flags, mode_t mode);
+  [[nodiscard]] SocketAwaitable socket_direct(int domain, int type, int protocol);
+
+  // run blocking or CPU heavy work on the offload pool, resuming on this loop with its result
+  template <typename Fn>
+  [[nodiscard]] OffloadAwaitable<Fn> offload(Fn fn);
 
   // non awaitable versions of the above functions so that they can be polled instead (_na = non awaitable)
   Errnos read_na(int fd, uint8_t* buffer, size_t length);
@@ -158,6 +576,11 @@ public:
   Errnos statx_na(int dirfd, const char* pathname, int flags, unsigned int mask, struct statx* statxbuf);
   Errnos unlinkat_na(int dirfd, const char* pathname, int flags);
   Errnos renameat_na(int olddirfd, const char* oldpathname, int newdirfd, const char* newpathname, int flags);
+  Errnos post_message_na(EventManager* target, uint64_t data, int32_t value = 0);
+  Errnos recv_provided_na(int sockfd, ProvidedBufferRing* buffers, int flags = 0);
+  Errnos read_fixed_na(int fd, unsigned buf_index, size_t buf_offset, size_t length, uint64_t offset = 0);
+  Errnos write_fixed_na(int fd, unsigned buf_index, size_t buf_offset, size_t length, uint64_t offset = 0);
+  Errnos socket_na(int domain, int type, int protocol);
   EvTask poll(PollHandler handler);
 
   // for batch submissions
@@ -0,0 +1,81 @@
+#ifndef EVENT_MANAGER_OPTIONS_
+#define EVENT_MANAGER_OPTIONS_
+
+#include <cstdint>
+#include <vector>
+
+enum class SubmissionMode {
+  IMMEDIATE,  // every operation is submitted to the kernel as soon as it is awaited/requested
+  DEFERRED    // operations are only queued, and the event loop submits them all at once before it waits
+};
+
+enum class WaitPolicy {
+  BLOCK,              // block in the kernel as soon as there's nothing to process
+  SPIN_THEN_BLOCK,    // spin on the completion queue for the spin budget first, and then block
+  SPIN_THEN_TIMEOUT,  // spin for the spin budget first, and then block for at most wait_timeout_us
+};
+
+// which io-wq (the kernel's pool of workers for operations which can't complete inline) a ring uses
+enum class WorkQueueMode {
+  PROCESS_SHARED,  // attach to the io-wq of the first ring made in the process that is still alive
+  OWN,             // give the ring its own io-wq
+  ATTACH           // attach to the io-wq of the ring given by attach_wq_fd
+};
+
+struct EventManagerOptions {
+  SubmissionMode submission_mode{SubmissionMode::IMMEDIATE};
+
+  // most coroutines resumed per loop iteration, the rest run on the next one (0 = all which were ready
+  // when the iteration started), lower values mean submitting and harvesting completions more often
+  unsigned max_resumes_per_tick{};
+
+  // trades CPU time for latency when waiting on completions, the spin stops at whichever
+  // budget runs out first (0 = unlimited, but at least one budget must be set to spin at all)
+  WaitPolicy wait_policy{WaitPolicy::BLOCK};
+  uint64_t spin_budget_ns{};
+  uint64_t spin_budget_iterations{};
+  uint64_t wait_timeout_us{};  // only used with WaitPolicy::SPIN_THEN_TIMEOUT, 0 = block
+
+  // have a kernel thread poll the submission queue (IORING_SETUP_SQPOLL), so submitting
+  // doesn't need a syscall unless the thread has gone idle
+  bool sq_poll{};
+  unsigned sq_thread_idle_ms{};  // how long the thread polls without work before sleeping, 0 = kernel default
+  int sq_thread_cpu{-1};         // CPU the thread is pinned to, -1 to leave it unpinned
+
+  // these lower the per operation overhead when a ring is only ever used by the thread running its loop
+  bool single_issuer{};   // IORING_SETUP_SINGLE_ISSUER, only one thread ever submits to the ring
+  bool defer_taskrun{};   // IORING_SETUP_DEFER_TASKRUN, completion work only runs when the loop asks for
+                          // events (implies single_issuer, can't be used with sq_poll)
+  bool coop_taskrun{};    // IORING_SETUP_COOP_TASKRUN, don't interrupt the thread to run completion work
+  bool taskrun_flag{};    // IORING_SETUP_TASKRUN_FLAG, flag in the ring when completion work is pending
+                          // (needs coop_taskrun or defer_taskrun)
+  bool submit_all{};      // IORING_SETUP_SUBMIT_ALL, keep submitting a batch even if an entry in it fails
+  unsigned cq_entries{};  // IORING_SETUP_CQSIZE, size of the completion queue, 0 = twice the queue depth
+
+  // when non zero, also set up a secondary IOPOLL ring of this depth for O_DIRECT file I/O (read_polled
+  // and write_polled), whose completions the loop reaps by polling instead of waiting for interrupts
+  unsigned polled_queue_depth{};
+
+  WorkQueueMode work_queue_mode{WorkQueueMode::PROCESS_SHARED};
+  int attach_wq_fd{-1};  // only used with WorkQueueMode::ATTACH
+
+  // caps on the io-wq workers which run operations the kernel can't complete inline (i.e openat, statx or
+  // buffered file writes), bounded ones are for regular files and unbounded ones for i.e sockets, 0 = no cap
+  unsigned io_wq_bounded_workers{};
+  unsigned io_wq_unbounded_workers{};
+  // CPUs io-wq workers may run on (empty = anywhere), which applies to the constructing thread's io-wq
+  std::vector<int> io_wq_cpus{};
+
+  // worker threads in the pool for offload(), which is only made on first use (unless a pool is shared
+  // with EventManager::use_offload_pool)
+  unsigned offload_threads{2};
+  // size of each block in the event manager's IOBuf pool, 0 isn't allowed and gets the default
+  // size of each block in the event manager's IOBuf pool
+  uint32_t iobuf_block_size{16 * 1024};
+
+  // register the ring's own fd so io_uring_enter can skip looking it up, note this registration is
+  // only valid in the thread which constructs the event manager
+  bool register_ring_fd{};
+};
+
+#endif
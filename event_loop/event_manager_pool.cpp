@@ -0,0 +1,92 @@
+#include "event_manager_pool.hpp"
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+
+EventManagerPool::EventManagerPool(EventManagerPoolOptions options) {
+  // the loops are started one at a time, since with a shared io-wq the rings after the first attach to it
+  int first_ring_fd = -1;
+  if (options.work_stealing) {
+    _stealing_group = std::make_unique<WorkStealingGroup>(options.cpus.size());
+  }
+
+  for (int cpu : options.cpus) {
+    auto& loop = *_loops.emplace_back(std::make_unique<Loop>());
+
+    auto manager_options = options.manager_options;
+    manager_options.work_queue_mode = WorkQueueMode::OWN;
+    if (options.shared_work_queue && first_ring_fd >= 0) {
+      manager_options.work_queue_mode = WorkQueueMode::ATTACH;
+      manager_options.attach_wq_fd = first_ring_fd;
+    }
+
+    std::promise<void> ready{};
+    auto ready_future = ready.get_future();
+    loop.thread = std::thread(&EventManagerPool::run_loop, this, std::ref(loop), cpu, options.queue_depth,
+                              manager_options, std::move(ready));
+    ready_future.wait();
+
+    if (first_ring_fd < 0) {
+      first_ring_fd = loop.ev->ring_fd();
+    }
+  }
+}
+
+EventManagerPool::~EventManagerPool() {
+  shutdown();
+}
+
+void EventManagerPool::run_loop(Loop& loop, int cpu, size_t queue_depth, EventManagerOptions options,
+                                std::promise<void> ready) {
+  if (cpu >= 0) {
+    cpu_set_t cpu_set{};
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (ret != 0) {
+      // not fatal, the loop just runs wherever the scheduler puts it
+      std::cerr << "Unable to pin the loop thread to CPU " << cpu << ": " << strerror(ret) << "\n";
+    }
+  }
+
+  loop.ev = std::make_unique<EventManager>(queue_depth, options);
+  if (_stealing_group) {
+    loop.ev->join_work_stealing(_stealing_group.get());
+  }
+
+  ready.set_value();
+
+  loop.ev->start();
+}
+
+bool EventManagerPool::spawn_on(size_t core, EvTask&& task) {
+  if (core >= _loops.size()) {
+    std::cerr << "There is no loop " << core << " in the pool\n";
+    return false;
+  }
+  if (_shut_down.load()) {
+    return false;
+  }
+
+  _loops[core]->ev->enqueue_task(std::move(task));
+  return true;
+}
+
+void EventManagerPool::shutdown() {
+  if (_shut_down.exchange(true)) {
+    return;
+  }
+
+  // ask every loop to kill itself first, so they all shut down together rather than one by one
+  for (auto& loop : _loops) {
+    loop->ev->enqueue_call([](EventManager* ev) { ev->register_coro(ev->kill()); });
+  }
+
+  for (auto& loop : _loops) {
+    if (loop->thread.joinable()) {
+      loop->thread.join();
+    }
+  }
+}
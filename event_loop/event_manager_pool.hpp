@@ -0,0 +1,74 @@
+#ifndef EVENT_MANAGER_POOL_
+#define EVENT_MANAGER_POOL_
+
+#include <atomic>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "coroutine/task.hpp"
+#include "event_loop/event_manager.hpp"
+#include "event_loop/event_manager_options.hpp"
+#include "event_loop/work_stealing.hpp"
+
+struct EventManagerPoolOptions {
+  // one loop thread is started per entry, pinned to that CPU (or left unpinned for -1)
+  std::vector<int> cpus{};
+  size_t queue_depth{256};
+
+  // have every ring share the first ring's io-wq, rather than each ring getting its own
+  bool shared_work_queue{};
+
+  // put every loop in one work stealing group, so idle loops take migratable coroutines from busy ones
+  bool work_stealing{};
+
+  // used for every ring, apart from the io-wq mode which is picked by shared_work_queue
+  EventManagerOptions manager_options{};
+};
+
+/*
+Thread per core runtime, each loop thread is pinned to its CPU and owns an EventManager (which is
+constructed on that thread, so options like single_issuer and register_ring_fd work as expected)
+
+Tasks are handed to a loop with spawn_on, which is safe to call from any thread (it goes through the
+loop's inbox), and shutdown() kills every loop and joins the threads (as does the destructor)
+*/
+class EventManagerPool {
+  struct Loop {
+    std::unique_ptr<EventManager> ev{};
+    std::thread thread{};
+  };
+
+  std::unique_ptr<WorkStealingGroup> _stealing_group{};
+  std::vector<std::unique_ptr<Loop>> _loops{};
+  std::atomic<bool> _shut_down{};
+
+  void run_loop(Loop& loop, int cpu, size_t queue_depth, EventManagerOptions options,
+                std::promise<void> ready);
+
+public:
+  explicit EventManagerPool(EventManagerPoolOptions options);
+  ~EventManagerPool();
+
+  EventManagerPool(const EventManagerPool&) = delete;
+  EventManagerPool& operator=(const EventManagerPool&) = delete;
+
+  size_t size() const {
+    return _loops.size();
+  }
+
+  // the loop's event manager, only to be used from tasks running on that loop
+  EventManager* manager(size_t core) {
+    return _loops[core]->ev.get();
+  }
+
+  // run the task on the given loop, returns false if there is no such loop or it is shutting down
+  bool spawn_on(size_t core, EvTask&& task);
+
+  // kill every loop and wait for their threads to finish
+  void shutdown();
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "fixed_buffers.hpp"
+#include <cerrno>
+#include <sys/mman.h>
+
+FixedBufferTable::~FixedBufferTable() {
+  unregister();
+  free_arena();
+}
+
+void FixedBufferTable::free_arena() {
+  if (_arena != nullptr) {
+    munmap(_arena, _arena_size);
+    _arena = nullptr;
+    _arena_size = 0;
+  }
+}
+
+int FixedBufferTable::setup(unsigned num_buffers, size_t buffer_size, unsigned spare_slots) {
+  if (_registered) {
+    return -EBUSY;
+  }
+  if (num_buffers + spare_slots == 0 || (num_buffers != 0 && buffer_size == 0)) {
+    return -EINVAL;
+  }
+
+  free_arena();  // from a table which has since been unregistered
+  if (num_buffers != 0) {
+    // a mapping rather than the heap, so buffers start page aligned (which O_DIRECT needs too)
+    _arena_size = static_cast<size_t>(num_buffers) * buffer_size;
+    auto arena = mmap(nullptr, _arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena == MAP_FAILED) {
+      _arena_size = 0;
+      return -errno;
+    }
+    _arena = static_cast<uint8_t*>(arena);
+  }
+
+  _slots.assign(num_buffers + spare_slots, iovec{});
+  for (unsigned i = 0; i < num_buffers; i++) {
+    _slots[i] = {.iov_base = _arena + static_cast<size_t>(i) * buffer_size, .iov_len = buffer_size};
+  }
+
+  int ret = register_slots(num_buffers, spare_slots);
+  if (ret < 0) {
+    _slots.clear();
+    free_arena();
+    return ret;
+  }
+  return 0;
+}
+
+int FixedBufferTable::setup_from_arena(const BufferArena& arena, unsigned spare_slots) {
+  if (_registered) {
+    return -EBUSY;
+  }
+  if (!arena.mapped()) {
+    return -EINVAL;
+  }
+
+  // the arena's slabs go in as they are, slab i becoming buffer i, and the arena stays the caller's
+  free_arena();
+  const auto num_slabs = static_cast<unsigned>(arena.num_slabs());
+  _slots.assign(num_slabs + spare_slots, iovec{});
+  for (unsigned i = 0; i < num_slabs; i++) {
+    _slots[i] = {.iov_base = arena.slab(i), .iov_len = arena.slab_size()};
+  }
+
+  int ret = register_slots(num_slabs, spare_slots);
+  if (ret < 0) {
+    _slots.clear();
+  }
+  return ret;
+}
+
+int FixedBufferTable::register_slots(unsigned num_buffers, unsigned spare_slots) {
+  // a table with spare slots has to be registered sparse, then the filled slots are put in place
+  int ret = 0;
+  if (spare_slots == 0) {
+    ret = io_uring_register_buffers(_ring, _slots.data(), num_buffers);
+  } else {
+    ret = io_uring_register_buffers_sparse(_ring, num_buffers + spare_slots);
+    if (ret == 0 && num_buffers != 0) {
+      ret = io_uring_register_buffers_update_tag(_ring, 0, _slots.data(), nullptr, num_buffers);
+      if (ret >= 0) {
+        ret = 0;
+      } else {
+        io_uring_unregister_buffers(_ring);
+      }
+    }
+  }
+
+  if (ret == 0) {
+    _registered = true;
+  }
+  return ret;
+}
+
+int FixedBufferTable::update(unsigned index, uint8_t* buffer, size_t length) {
+  if (!_registered || index >= _slots.size()) {
+    return -EINVAL;
+  }
+
+  iovec slot{.iov_base = buffer, .iov_len = buffer == nullptr ? 0 : length};
+  int ret = io_uring_register_buffers_update_tag(_ring, index, &slot, nullptr, 1);
+  if (ret < 0) {
+    return ret;
+  }
+
+  _slots[index] = slot;
+  return 0;
+}
+
+void FixedBufferTable::unregister() {
+  if (_registered) {
+    io_uring_unregister_buffers(_ring);
+    _registered = false;
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef FIXED_BUFFERS_
+#define FIXED_BUFFERS_
+
+#include <bits/types/struct_iovec.h>
+#include <cstddef>
+#include <cstdint>
+#include <liburing.h>
+#include <vector>
+
+#include "event_loop/buffer_arena.hpp"
+
+/*
+The ring's table of registered (fixed) buffers, whose pages the kernel pins once when they're registered
+rather than on every operation, which read_fixed and write_fixed then refer to by index
+
+setup carves an arena (one mapping) into equally sized buffers which take the first slots, and can leave
+spare slots after them, which are sparse until update fills them with the caller's own memory (and
+can be changed again later, i.e to swap a buffer out while nothing in flight uses it). There's one table
+per ring, owned by the event manager, see EventManager::fixed_buffers
+*/
+class FixedBufferTable {
+  io_uring* _ring{};
+  uint8_t* _arena{};
+  size_t _arena_size{};
+  std::vector<iovec> _slots{};
+  bool _registered{};
+
+  void free_arena();
+  int register_slots(unsigned num_buffers, unsigned spare_slots);
+
+public:
+  explicit FixedBufferTable(io_uring* ring) : _ring(ring) {}
+  ~FixedBufferTable();
+
+  FixedBufferTable(const FixedBufferTable&) = delete;
+  FixedBufferTable& operator=(const FixedBufferTable&) = delete;
+
+  // returns 0 or a negative errno, only one table can be registered at a time
+  int setup(unsigned num_buffers, size_t buffer_size, unsigned spare_slots = 0);
+  // registers a buffer arena's slabs instead, slab i as buffer i, the arena has to outlive the registration
+  int setup_from_arena(const BufferArena& arena, unsigned spare_slots = 0);
+  // fill (or replace) a slot, a nullptr buffer leaves it empty again, returns 0 or a negative errno
+  int update(unsigned index, uint8_t* buffer, size_t length);
+  // the event manager does this before its ring is torn down, the arena stays around until this is destroyed
+  void unregister();
+
+  bool registered() const {
+    return _registered;
+  }
+  unsigned size() const {
+    return static_cast<unsigned>(_slots.size());
+  }
+  // nullptr for slots which are empty or out of range
+  uint8_t* buffer(unsigned index) const {
+    return index < _slots.size() ? static_cast<uint8_t*>(_slots[index].iov_base) : nullptr;
+  }
+  size_t length(unsigned index) const {
+    return index < _slots.size() ? _slots[index].iov_len : 0;
+  }
+  // whether [offset, offset + length) lies inside the slot's buffer
+  bool contains(unsigned index, size_t offset, size_t length) const {
+    const auto slot_length = this->length(index);
+    return buffer(index) != nullptr && offset <= slot_length && length <= slot_length - offset;
+  }
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "fixed_files.hpp"
+#include <cerrno>
+
+FixedFileTable::~FixedFileTable() {
+  unregister();
+}
+
+int FixedFileTable::setup(unsigned num_slots, unsigned reserved_slots) {
+  if (_registered) {
+    return -EBUSY;
+  }
+  if (num_slots == 0 || reserved_slots > num_slots) {
+    return -EINVAL;
+  }
+
+  int ret = io_uring_register_files_sparse(_ring, num_slots);
+  if (ret < 0) {
+    return ret;
+  }
+
+  // keep the kernel from handing out the reserved slots
+  if (reserved_slots != 0) {
+    ret = io_uring_register_file_alloc_range(_ring, reserved_slots, num_slots - reserved_slots);
+    if (ret < 0) {
+      io_uring_unregister_files(_ring);
+      return ret;
+    }
+  }
+
+  _size = num_slots;
+  _reserved_in_use.assign(reserved_slots, false);
+  _in_use = 0;
+  _registered = true;
+  return 0;
+}
+
+int FixedFileTable::update(unsigned index, int fd) {
+  if (!_registered || index >= _reserved_in_use.size()) {
+    return -EINVAL;
+  }
+
+  int ret = io_uring_register_files_update(_ring, index, &fd, 1);
+  if (ret < 0) {
+    return ret;
+  }
+
+  const bool now_in_use = fd >= 0;
+  if (now_in_use != _reserved_in_use[index]) {
+    _in_use = now_in_use ? _in_use + 1 : _in_use - 1;
+    _reserved_in_use[index] = now_in_use;
+  }
+  return 0;
+}
+
+void FixedFileTable::unregister() {
+  if (_registered) {
+    io_uring_unregister_files(_ring);
+    _registered = false;
+  }
+}
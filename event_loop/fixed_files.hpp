@@ -0,0 +1,72 @@
+#ifndef FIXED_FILES_
+#define FIXED_FILES_
+
+#include <cstddef>
+#include <liburing.h>
+#include <vector>
+
+// a slot in the ring's direct (registered) file table, which operations use instead of an fd, it's only
+// valid on the ring whose table it's in
+struct FixedFile {
+  unsigned index{};
+};
+
+/*
+The ring's direct file table, operations on files in it skip looking the fd up in the process' file table
+(the fget/fput on every submission), which threads sharing the file table otherwise contend on
+
+The table is registered sparse, with the kernel picking a free slot for the direct variants of accept,
+openat and socket, apart from any reserved slots at the start, which are only filled by update (i.e
+with an fd opened some other way). There's one table per ring, owned by the event manager, see
+EventManager::fixed_files
+*/
+class FixedFileTable {
+  io_uring* _ring{};
+  unsigned _size{};
+  std::vector<bool> _reserved_in_use{};
+  size_t _in_use{};
+  bool _registered{};
+
+public:
+  explicit FixedFileTable(io_uring* ring) : _ring(ring) {}
+  ~FixedFileTable();
+
+  FixedFileTable(const FixedFileTable&) = delete;
+  FixedFileTable& operator=(const FixedFileTable&) = delete;
+
+  // returns 0 or a negative errno, only one table can be registered at a time
+  int setup(unsigned num_slots, unsigned reserved_slots = 0);
+  // put an fd in a reserved slot (the table takes its own reference, so the fd can be closed after),
+  // or empty it with -1, returns 0 or a negative errno
+  int update(unsigned index, int fd);
+  // the event manager does this before its ring is torn down
+  void unregister();
+
+  // called by the event manager as direct operations complete
+  void slot_filled() {
+    _in_use++;
+  }
+  void slot_emptied(unsigned index) {
+    if (index < _reserved_in_use.size()) {
+      if (!_reserved_in_use[index]) {
+        return;
+      }
+      _reserved_in_use[index] = false;
+    }
+    if (_in_use != 0) {
+      _in_use--;
+    }
+  }
+
+  bool registered() const {
+    return _registered;
+  }
+  unsigned size() const {
+    return _size;
+  }
+  size_t in_use() const {
+    return _in_use;
+  }
+};
+
+#endif
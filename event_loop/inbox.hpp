@@ -0,0 +1,71 @@
+#ifndef INBOX_
+#define INBOX_
+
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <utility>
+
+#include "coroutine/task.hpp"
+
+class EventManager;
+
+// something another thread handed to an event manager, either a task to start or a call to make
+struct InboxItem {
+  InboxItem* next{};
+  std::optional<EvTask> task{};
+  std::function<void(EventManager*)> call{};  // i.e to queue up _na operations on the loop's thread
+};
+
+/*
+Lock free multiple producer, single consumer inbox (a Treiber stack), any thread can push while only
+the owning loop takes items, and it takes everything at once with a single exchange, reversing the
+list so that items are handled in the order they were pushed
+*/
+class Inbox {
+  std::atomic<InboxItem*> _head{};
+
+public:
+  Inbox() = default;
+  Inbox(const Inbox&) = delete;
+  Inbox& operator=(const Inbox&) = delete;
+
+  ~Inbox() {
+    auto item = take_all();
+    while (item != nullptr) {
+      delete std::exchange(item, item->next);
+    }
+  }
+
+  // returns true if the inbox was empty, in which case the consumer needs waking up
+  bool push(InboxItem* item) {
+    auto head = _head.load(std::memory_order_relaxed);
+    do {
+      item->next = head;
+    } while (!_head.compare_exchange_weak(head, item, std::memory_order_release, std::memory_order_relaxed));
+    return head == nullptr;
+  }
+
+  // consumer only, the items in the order they were pushed, to be deleted once handled
+  InboxItem* take_all() {
+    if (_head.load(std::memory_order_relaxed) == nullptr) {
+      return nullptr;
+    }
+
+    auto item = _head.exchange(nullptr, std::memory_order_acquire);
+    InboxItem* in_order = nullptr;
+    while (item != nullptr) {
+      auto next = item->next;
+      item->next = in_order;
+      in_order = item;
+      item = next;
+    }
+    return in_order;
+  }
+
+  bool empty() const {
+    return _head.load(std::memory_order_relaxed) == nullptr;
+  }
+};
+
+#endif
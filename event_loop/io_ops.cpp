@@ -11,14 +11,17 @@
 
 using namespace ErrorProcessing;
 
+// for stuff like submissions, repeat up to MAX_ITER times before giving up
+constexpr const size_t MAX_ITER = 1000;
+
 struct RetrieveCurrentHandle {
   EvTask::Handle handle;
   bool await_ready() noexcept {
     return false;
   }
-  void await_suspend(EvTask::Handle h) noexcept {
+  bool await_suspend(EvTask::Handle h) noexcept {
     handle = h;
-    handle.resume();
+    return false;  // carry straight on, without resuming from inside this call
   }
   EvTask::Handle await_resume() noexcept {
     return handle;
@@ -37,6 +40,18 @@ WriteAwaitable EventManager::write(int fd, const uint8_t* buffer, size_t length)
   return WriteAwaitable{fd, buffer, length, this};
 }
 
+ReadAwaitable EventManager::read_polled(int fd, uint8_t* buffer, size_t length, uint64_t offset) {
+  if (should_restrict_usage())
+    return {};
+  return ReadAwaitable{fd, buffer, length, this, offset, true};
+}
+
+WriteAwaitable EventManager::write_polled(int fd, const uint8_t* buffer, size_t length, uint64_t offset) {
+  if (should_restrict_usage())
+    return {};
+  return WriteAwaitable{fd, buffer, length, this, offset, true};
+}
+
 CloseAwaitable EventManager::close(int fd) {
   if (should_restrict_usage())
     return {};
@@ -96,14 +111,177 @@ RenameatAwaitable EventManager::renameat(int olddirfd, const char* oldpathname,
   return RenameatAwaitable{olddirfd, oldpathname, newdirfd, newpathname, flags, this};
 }
 
+MsgRingAwaitable EventManager::post_message(EventManager* target, uint64_t data, int32_t value) {
+  if (should_restrict_usage())
+    return {};
+  if (target == nullptr || data > RequestTable::MAX_POSTED_PAYLOAD) {
+    std::cerr << "Messages need a target and data which fits in 56 bits\n";
+    return {};
+  }
+  return MsgRingAwaitable{target->ring_fd(), data, value, nullptr, this};
+}
+
+MsgRingAwaitable EventManager::post_task(EventManager* target, EvTask&& task) {
+  if (should_restrict_usage() || target == nullptr)
+    return {};
+  return MsgRingAwaitable{target->ring_fd(), 0, 0, new EvTask(std::move(task)), this};
+}
+
+RecvProvidedAwaitable EventManager::recv_provided(int sockfd, ProvidedBufferRing* buffers, int flags) {
+  if (should_restrict_usage() || buffers == nullptr)
+    return {};
+  return RecvProvidedAwaitable{sockfd, buffers, flags, this};
+}
+
+ReadFixedAwaitable EventManager::read_fixed(int fd, unsigned buf_index, size_t buf_offset, size_t length,
+                                            uint64_t offset) {
+  if (should_restrict_usage() || !_fixed_buffers.contains(buf_index, buf_offset, length))
+    return {};
+  return ReadFixedAwaitable{
+      fd, buf_index, buf_offset, _fixed_buffers.buffer(buf_index) + buf_offset, length, offset, this};
+}
+
+WriteFixedAwaitable EventManager::write_fixed(int fd, unsigned buf_index, size_t buf_offset, size_t length,
+                                              uint64_t offset) {
+  if (should_restrict_usage() || !_fixed_buffers.contains(buf_index, buf_offset, length))
+    return {};
+  return WriteFixedAwaitable{
+      fd, buf_index, buf_offset, _fixed_buffers.buffer(buf_index) + buf_offset, length, offset, this};
+}
+
+SocketAwaitable EventManager::socket(int domain, int type, int protocol) {
+  if (should_restrict_usage())
+    return {};
+  return SocketAwaitable{domain, type, protocol, this};
+}
+
+ReadvAwaitable EventManager::readv(int fd, IOBufChain& chain) {
+  auto iovecs = chain.tail_iovecs();
+  return readv(fd, iovecs.data(), iovecs.size());
+}
+
+WritevAwaitable EventManager::writev(int fd, IOBufChain& chain) {
+  auto iovecs = chain.data_iovecs();
+  return writev(fd, iovecs.data(), iovecs.size());
+}
+
+ReadAwaitable EventManager::read(FixedFile file, uint8_t* buffer, size_t length) {
+  auto awaitable = read(static_cast<int>(file.index), buffer, length);
+  awaitable.req_data.fixed_file = true;
+  return awaitable;
+}
+
+WriteAwaitable EventManager::write(FixedFile file, const uint8_t* buffer, size_t length) {
+  auto awaitable = write(static_cast<int>(file.index), buffer, length);
+  awaitable.req_data.fixed_file = true;
+  return awaitable;
+}
+
+CloseAwaitable EventManager::close(FixedFile file) {
+  if (should_restrict_usage())
+    return {};
+  return CloseAwaitable{static_cast<int>(file.index), this, true};
+}
+
+ShutdownAwaitable EventManager::shutdown(FixedFile file, int how) {
+  auto awaitable = shutdown(static_cast<int>(file.index), how);
+  awaitable.req_data.fixed_file = true;
+  return awaitable;
+}
+
+ReadvAwaitable EventManager::readv(FixedFile file, struct iovec* iovs, size_t num) {
+  auto awaitable = readv(static_cast<int>(file.index), iovs, num);
+  awaitable.req_data.fixed_file = true;
+  return awaitable;
+}
+
+WritevAwaitable EventManager::writev(FixedFile file, struct iovec* iovs, size_t num) {
+  auto awaitable = writev(static_cast<int>(file.index), iovs, num);
+  awaitable.req_data.fixed_file = true;
+  return awaitable;
+}
+
+AcceptAwaitable EventManager::accept(FixedFile file, sockaddr* addr, socklen_t* addrlen) {
+  auto awaitable = accept(static_cast<int>(file.index), addr, addrlen);
+  awaitable.req_data.fixed_file = true;
+  return awaitable;
+}
+
+ConnectAwaitable EventManager::connect(FixedFile file, const sockaddr* addr, socklen_t addrlen) {
+  auto awaitable = connect(static_cast<int>(file.index), addr, addrlen);
+  awaitable.req_data.fixed_file = true;
+  return awaitable;
+}
+
+RecvProvidedAwaitable EventManager::recv_provided(FixedFile file, ProvidedBufferRing* buffers, int flags) {
+  auto awaitable = recv_provided(static_cast<int>(file.index), buffers, flags);
+  awaitable.req_data.fixed_file = true;
+  return awaitable;
+}
+
+ReadFixedAwaitable EventManager::read_fixed(FixedFile file, unsigned buf_index, size_t buf_offset,
+                                            size_t length, uint64_t offset) {
+  auto awaitable = read_fixed(static_cast<int>(file.index), buf_index, buf_offset, length, offset);
+  awaitable.req_data.fixed_file = true;
+  return awaitable;
+}
+
+WriteFixedAwaitable EventManager::write_fixed(FixedFile file, unsigned buf_index, size_t buf_offset,
+                                              size_t length, uint64_t offset) {
+  auto awaitable = write_fixed(static_cast<int>(file.index), buf_index, buf_offset, length, offset);
+  awaitable.req_data.fixed_file = true;
+  return awaitable;
+}
+
+AcceptAwaitable EventManager::accept_direct(int sockfd, sockaddr* addr, socklen_t* addrlen) {
+  if (should_restrict_usage())
+    return {};
+  return AcceptAwaitable{sockfd, addr, addrlen, this, true};
+}
+
+AcceptAwaitable EventManager::accept_direct(FixedFile file, sockaddr* addr, socklen_t* addrlen) {
+  auto awaitable = accept_direct(static_cast<int>(file.index), addr, addrlen);
+  awaitable.req_data.fixed_file = true;
+  return awaitable;
+}
+
+OpenatAwaitable EventManager::openat_direct(int dirfd, const char* pathname, int flags, mode_t mode) {
+  if (should_restrict_usage())
+    return {};
+  return OpenatAwaitable{dirfd, pathname, flags, mode, this, true};
+}
+
+SocketAwaitable EventManager::socket_direct(int domain, int type, int protocol) {
+  if (should_restrict_usage())
+    return {};
+  return SocketAwaitable{domain, type, protocol, this, true};
+}
+
 RequestQueue EventManager::make_request_queue() {
   return RequestQueue{};
 }
 
 bool EventManager::process_single_generic_request(const OperationParameterPackVariant& req,
-                                                  RequestData& single_req, EvTask::Handle handle) {
+                                                  RequestData& single_req, EvTask::Handle handle,
+                                                  uint64_t& user_data) {
   auto req_type = static_cast<RequestType>(req.index());
 
+  // refused before an SQE is taken, since one left unprepared would still be submitted with whatever
+  // operation (and user data) it last held
+  if (!fixed_range_valid(req)) {
+    std::cerr << "Fixed buffer ranges have to fit inside the registered buffer\n";
+    return false;
+  }
+  if (auto* pack = std::get_if<MsgRingParameterPack>(&req);
+      pack && (pack->target == nullptr || pack->data > RequestTable::MAX_POSTED_PAYLOAD)) {
+    std::cerr << "Messages need a target and data which fits in 56 bits\n";
+    return false;
+  }
+  if (auto* pack = std::get_if<RecvProvidedParameterPack>(&req); pack && pack->buffers == nullptr) {
+    std::cerr << "Provided buffer recvs need a buffer ring to pick from\n";
+    return false;
+  }
+
   auto sqe = get_uring_sqe();
 
   if (sqe == nullptr) {
@@ -114,7 +292,7 @@ bool EventManager::process_single_generic_request(const OperationParameterPackVa
 
   single_req.handle = handle;
   single_req.req_type = req_type;
-  single_req.allocated_dynamic = false;
+  single_req.pooled = false;
   auto& specific_data = single_req.specific_data;
 
   switch (req_type) {
@@ -122,7 +300,7 @@ bool EventManager::process_single_generic_request(const OperationParameterPackVa
     auto* pack = std::get_if<ReadParameterPack>(&req);
     if (pack) {
       specific_data.read_data = {pack->fd, pack->buffer, pack->length};
-      io_uring_prep_read(sqe, pack->fd, pack->buffer, pack->length, 0);
+      io_uring_prep_read(sqe, pack->fd, pack->buffer, pack->length, pack->offset);
     } else {
       std::cerr << "There was an error in retrieving queued data\n";
       return false;
@@ -133,7 +311,7 @@ bool EventManager::process_single_generic_request(const OperationParameterPackVa
     auto* pack = std::get_if<WriteParameterPack>(&req);
     if (pack) {
       specific_data.write_data = {pack->fd, pack->buffer, pack->length};
-      io_uring_prep_write(sqe, pack->fd, pack->buffer, pack->length, 0);
+      io_uring_prep_write(sqe, pack->fd, pack->buffer, pack->length, pack->offset);
     } else {
       std::cerr << "There was an error in retrieving queued data\n";
       return false;
@@ -252,67 +430,178 @@ bool EventManager::process_single_generic_request(const OperationParameterPackVa
     }
     break;
   }
+  case RequestType::MSG_RING: {
+    auto* pack = std::get_if<MsgRingParameterPack>(&req);
+    if (pack) {
+      specific_data.msg_ring_data = {pack->target->ring_fd(), pack->data, pack->value};
+      io_uring_prep_msg_ring(sqe, specific_data.msg_ring_data.ring_fd, static_cast<uint32_t>(pack->value),
+                             RequestTable::posted_user_data(specific_data.msg_ring_data), 0);
+    } else {
+      std::cerr << "There was an error in retrieving queued data\n";
+      return false;
+    }
+    break;
+  }
+  case RequestType::RECV_PROVIDED: {
+    auto* pack = std::get_if<RecvProvidedParameterPack>(&req);
+    if (pack) {
+      specific_data.recv_provided_data = {pack->sockfd, pack->buffers, pack->flags};
+      io_uring_prep_recv(sqe, pack->sockfd, nullptr, pack->buffers->buffer_size(), pack->flags);
+      sqe->flags |= IOSQE_BUFFER_SELECT;
+      sqe->buf_group = pack->buffers->group_id();
+    } else {
+      std::cerr << "There was an error in retrieving queued data\n";
+      return false;
+    }
+    break;
+  }
+  case RequestType::READ_FIXED: {
+    auto* pack = std::get_if<ReadFixedParameterPack>(&req);
+    if (pack) {
+      auto buffer = _fixed_buffers.buffer(pack->buf_index) + pack->buf_offset;
+      specific_data.read_fixed_data = {pack->fd, pack->buf_index, pack->buf_offset, pack->length,
+                                       pack->offset, buffer};
+      io_uring_prep_read_fixed(sqe, pack->fd, buffer, static_cast<unsigned>(pack->length), pack->offset,
+                               static_cast<int>(pack->buf_index));
+    } else {
+      std::cerr << "There was an error in retrieving queued data\n";
+      return false;
+    }
+    break;
+  }
+  case RequestType::WRITE_FIXED: {
+    auto* pack = std::get_if<WriteFixedParameterPack>(&req);
+    if (pack) {
+      auto buffer = _fixed_buffers.buffer(pack->buf_index) + pack->buf_offset;
+      specific_data.write_fixed_data = {pack->fd, pack->buf_index, pack->buf_offset, pack->length,
+                                        pack->offset, buffer};
+      io_uring_prep_write_fixed(sqe, pack->fd, buffer, static_cast<unsigned>(pack->length), pack->offset,
+                                static_cast<int>(pack->buf_index));
+    } else {
+      std::cerr << "There was an error in retrieving queued data\n";
+      return false;
+    }
+    break;
+  }
+  case RequestType::SOCKET: {
+    auto* pack = std::get_if<SocketParameterPack>(&req);
+    if (pack) {
+      specific_data.socket_data = {pack->domain, pack->type, pack->protocol};
+      io_uring_prep_socket(sqe, pack->domain, pack->type, pack->protocol, 0);
+    } else {
+      std::cerr << "There was an error in retrieving queued data\n";
+      return false;
+    }
+    break;
+  }
+  case RequestType::ACCEPT_MULTISHOT: {
+    // its completions go to an AcceptStream rather than the batch, so it can't be queued up with one
+    std::cerr << "Multishot accepts can only be armed by an AcceptStream\n";
+    io_uring_prep_nop(sqe);
+    io_uring_sqe_set_data64(sqe, 0);
+    return false;
+  }
   }
 
-  io_uring_sqe_set_data(sqe, &single_req);
+  user_data = _request_table.insert(&single_req);
+  io_uring_sqe_set_data64(sqe, user_data);
 
   return true;
 }
 
+bool EventManager::fixed_range_valid(const OperationParameterPackVariant& req) const {
+  if (auto* pack = std::get_if<ReadFixedParameterPack>(&req)) {
+    return _fixed_buffers.contains(pack->buf_index, pack->buf_offset, pack->length);
+  }
+  if (auto* pack = std::get_if<WriteFixedParameterPack>(&req)) {
+    return _fixed_buffers.contains(pack->buf_index, pack->buf_offset, pack->length);
+  }
+  return true;
+}
+
 EvTask EventManager::submit_and_wait(const RequestQueue& request_queue, SubmitAndWaitHandler handler) {
   auto& requests_vec = request_queue.req_vec;
 
-  auto ret = submit_queued_entries();
-  if (ret < 0) {
-    co_return ret;
-  }
-
   std::vector<RequestData> req_data{requests_vec.size()};
+  std::vector<uint64_t> user_data(requests_vec.size(), 0);
   auto handle = co_await RetrieveCurrentHandle{};
 
+  // req_data lives in this frame, so if it goes first (an early return, or the coroutine being
+  // destroyed while waiting) the requests' entries are released and their completions are ignored,
+  // releasing the ones which already completed again is harmless since their keys are stale by then
+  struct ForgetOnExit {
+    EventManager* ev;
+    const std::vector<uint64_t>& user_data;
+    ~ForgetOnExit() {
+      for (auto key : user_data) {
+        if (key != 0) {
+          ev->forget_request(key);
+        }
+      }
+    }
+  } forget_on_exit{this, user_data};
+
+  // only count our own requests, other coroutines may have entries queued too
+  size_t num_pending = 0;
+  std::vector<EventManager*> posting_to{};
   for (std::size_t i = 0; i < requests_vec.size(); i++) {
     auto& req = requests_vec[i];
     auto& single_req = req_data[i];
-    process_single_generic_request(req, single_req, handle);
-  }
 
-  // how many are currently being processed
-  size_t num_submitted = ret;
-
-  // how many are still queued for submission
-  auto num_queued = _ring.sq.sqe_tail - _ring.sq.sqe_head;
-
-  while (num_submitted != 0 || num_queued != 0) {
-    while (num_queued != 0 && num_submitted == 0) {
-      auto ret = submit_queued_entries();
-      if (ret < 0) {
-        co_return ret;
+    // posts keep their target from closing its ring until they're submitted, like post_to
+    if (auto* pack = std::get_if<MsgRingParameterPack>(&req); pack && pack->target != nullptr) {
+      if (!begin_post(pack->target)) {
+        std::cerr << "Messages can't be posted to an event manager which has been killed\n";
+        continue;
       }
+      posting_to.push_back(pack->target);
+    }
 
-      num_submitted += ret;
-      num_queued -= ret;
+    if (process_single_generic_request(req, single_req, handle, user_data[i])) {
+      num_pending++;
     }
+  }
 
-    for (size_t i = 0; i < num_submitted; i++) {
-      auto channel = co_await GenericResponse{};
-      auto response_type = channel->response_store_current_type();
-      handler(response_type, channel);
+  // when deferring, the event loop submits these before it next waits, unless they hold up a post
+  int submit_ret = 0;
+  size_t iter = 0;
+  while ((!submissions_deferred() || !posting_to.empty()) && io_uring_sq_ready(&_ring) != 0 &&
+         iter++ < MAX_ITER) {
+    submit_ret = submit_queued_entries();
+    if (submit_ret < 0) {
+      break;
     }
+  }
+  for (auto target : posting_to) {
+    end_post(target);
+  }
+  if (submit_ret < 0) {
+    co_return submit_ret;
+  }
 
-    num_submitted = 0;
+  for (; num_pending != 0; num_pending--) {
+    auto channel = co_await GenericResponse{};
+    auto response_type = channel->response_store_current_type();
+    handler(response_type, channel);
   }
 
   co_return 0;
 }
 
 Errnos EventManager::submit_request(io_uring_sqe* sqe, RequestData* req_data) {
-  io_uring_sqe_set_data(sqe, req_data);
+  const auto user_data = _request_table.insert(req_data);
+  io_uring_sqe_set_data64(sqe, user_data);
+
+  if (submissions_deferred()) {
+    return Errnos::UNKNOWN_ERROR;  // the event loop submits everything queued before it next waits
+  }
 
   auto ret = submit_queued_entries();
   if (ret < 1) {  // since submit returns the number of entries submitted
     std::cerr << "io_uring_submit failed\n";
-    if (req_data && req_data->allocated_dynamic) {
-      delete req_data;
+    _request_table.release(user_data);
+    if (req_data->pooled) {
+      release_request_data(req_data);
     }
     return static_cast<Errnos>(-ret);
   }
@@ -326,9 +615,8 @@ std::pair<io_uring_sqe*, RequestData*> EventManager::get_sqe_and_req_data(Reques
     return {nullptr, nullptr};
   }
 
-  auto req_data = new RequestData{};
+  auto req_data = acquire_request_data();
   req_data->req_type = req_type;
-  req_data->allocated_dynamic = true;
   return {sqe, req_data};
 }
 
@@ -504,6 +792,102 @@ Errnos EventManager::renameat_na(int olddirfd, const char* oldpathname, int newd
   return submit_request(sqe, req_data);
 }
 
+Errnos EventManager::post_message_na(EventManager* target, uint64_t data, int32_t value) {
+  if (target == nullptr || data > RequestTable::MAX_POSTED_PAYLOAD) {
+    std::cerr << "Messages need a target and data which fits in 56 bits\n";
+    return Errnos::UNKNOWN_ERROR;
+  }
+
+  auto [sqe, req_data] = get_sqe_and_req_data(RequestType::MSG_RING);
+
+  if (sqe == nullptr || req_data == nullptr) {
+    return Errnos::UNKNOWN_ERROR;
+  }
+
+  auto& msg_ring_data = req_data->specific_data.msg_ring_data;
+  msg_ring_data = {target->ring_fd(), data, value};
+  io_uring_prep_msg_ring(sqe, msg_ring_data.ring_fd, static_cast<uint32_t>(msg_ring_data.value),
+                         RequestTable::posted_user_data(msg_ring_data), 0);
+
+  return submit_request(sqe, req_data);
+}
+
+Errnos EventManager::recv_provided_na(int sockfd, ProvidedBufferRing* buffers, int flags) {
+  if (buffers == nullptr) {
+    return Errnos::UNKNOWN_ERROR;
+  }
+
+  auto [sqe, req_data] = get_sqe_and_req_data(RequestType::RECV_PROVIDED);
+
+  if (sqe == nullptr || req_data == nullptr) {
+    return Errnos::UNKNOWN_ERROR;
+  }
+
+  auto& recv_provided_data = req_data->specific_data.recv_provided_data;
+  recv_provided_data = {sockfd, buffers, flags};
+  io_uring_prep_recv(sqe, sockfd, nullptr, buffers->buffer_size(), flags);
+  sqe->flags |= IOSQE_BUFFER_SELECT;
+  sqe->buf_group = buffers->group_id();
+
+  return submit_request(sqe, req_data);
+}
+
+Errnos EventManager::read_fixed_na(int fd, unsigned buf_index, size_t buf_offset, size_t length,
+                                   uint64_t offset) {
+  if (!_fixed_buffers.contains(buf_index, buf_offset, length)) {
+    return Errnos::ERR_INVAL;
+  }
+
+  auto [sqe, req_data] = get_sqe_and_req_data(RequestType::READ_FIXED);
+
+  if (sqe == nullptr || req_data == nullptr) {
+    return Errnos::UNKNOWN_ERROR;
+  }
+
+  auto buffer = _fixed_buffers.buffer(buf_index) + buf_offset;
+  auto& read_fixed_data = req_data->specific_data.read_fixed_data;
+  read_fixed_data = {fd, buf_index, buf_offset, length, offset, buffer};
+  io_uring_prep_read_fixed(sqe, fd, buffer, static_cast<unsigned>(length), offset,
+                           static_cast<int>(buf_index));
+
+  return submit_request(sqe, req_data);
+}
+
+Errnos EventManager::write_fixed_na(int fd, unsigned buf_index, size_t buf_offset, size_t length,
+                                    uint64_t offset) {
+  if (!_fixed_buffers.contains(buf_index, buf_offset, length)) {
+    return Errnos::ERR_INVAL;
+  }
+
+  auto [sqe, req_data] = get_sqe_and_req_data(RequestType::WRITE_FIXED);
+
+  if (sqe == nullptr || req_data == nullptr) {
+    return Errnos::UNKNOWN_ERROR;
+  }
+
+  auto buffer = _fixed_buffers.buffer(buf_index) + buf_offset;
+  auto& write_fixed_data = req_data->specific_data.write_fixed_data;
+  write_fixed_data = {fd, buf_index, buf_offset, length, offset, buffer};
+  io_uring_prep_write_fixed(sqe, fd, buffer, static_cast<unsigned>(length), offset,
+                            static_cast<int>(buf_index));
+
+  return submit_request(sqe, req_data);
+}
+
+Errnos EventManager::socket_na(int domain, int type, int protocol) {
+  auto [sqe, req_data] = get_sqe_and_req_data(RequestType::SOCKET);
+
+  if (sqe == nullptr || req_data == nullptr) {
+    return Errnos::UNKNOWN_ERROR;
+  }
+
+  auto& socket_data = req_data->specific_data.socket_data;
+  socket_data = {domain, type, protocol};
+  io_uring_prep_socket(sqe, socket_data.domain, socket_data.type, socket_data.protocol, 0);
+
+  return submit_request(sqe, req_data);
+}
+
 EvTask EventManager::poll(PollHandler handler) {
   if (_polling_requests) {
     co_return -1;
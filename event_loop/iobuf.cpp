@@ -0,0 +1,168 @@
+#include "iobuf.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+void IOBuf::release() {
+  if (_block != nullptr && --_block->refs == 0) {
+    _block->pool->recycle(_block);
+  }
+  _block = nullptr;
+  _offset = 0;
+  _length = 0;
+}
+
+IOBuf IOBuf::slice(size_t offset, size_t length) const {
+  IOBuf sliced{*this};
+  sliced.trim_front(offset);
+  sliced._length = static_cast<uint32_t>(std::min<size_t>(length, sliced._length));
+  return sliced;
+}
+
+IOBufPool::IOBufPool(uint32_t block_size) : _block_size(block_size) {
+  if (_block_size == 0) {
+    std::cerr << "IOBuf blocks need a size, using " << DEFAULT_BLOCK_SIZE << " bytes\n";
+    _block_size = DEFAULT_BLOCK_SIZE;
+  }
+}
+
+void IOBufPool::grow() {
+  auto& headers = _headers.emplace_back(std::make_unique<IOBufBlock[]>(CHUNK_SIZE));
+  auto& storage = _storage.emplace_back(std::make_unique<uint8_t[]>(CHUNK_SIZE * _block_size));
+
+  // threaded onto the free list in order, so blocks are handed out lowest address first
+  for (size_t i = CHUNK_SIZE; i != 0; i--) {
+    auto& block = headers[i - 1];
+    block = {.data = storage.get() + (i - 1) * _block_size, .capacity = _block_size, .pool = this};
+    recycle(&block);
+  }
+}
+
+IOBuf IOBufPool::allocate() {
+  if (_free_head == nullptr) {
+    grow();
+  }
+
+  auto block = _free_head;
+  _free_head = block->next_free;
+  _num_free--;
+
+  block->next_free = nullptr;
+  block->refs = 1;
+  return IOBuf{block};
+}
+
+void IOBufChain::append(IOBufChain&& other) {
+  for (auto& buf : other._bufs) {
+    _bufs.push_back(std::move(buf));
+  }
+  other._bufs.clear();
+}
+
+size_t IOBufChain::tail_start() const {
+  for (size_t i = _bufs.size(); i != 0; i--) {
+    if (!_bufs[i - 1].empty()) {
+      return i - 1;
+    }
+  }
+  return 0;
+}
+
+void IOBufChain::reserve(IOBufPool& pool, size_t bytes) {
+  size_t tailroom = 0;
+  for (size_t i = tail_start(); i < _bufs.size(); i++) {
+    tailroom += _bufs[i].tailroom();
+  }
+
+  while (tailroom < bytes) {
+    _bufs.push_back(pool.allocate());
+    tailroom += _bufs.back().tailroom();
+  }
+}
+
+std::span<iovec> IOBufChain::data_iovecs() {
+  _iovecs.clear();
+  for (auto& buf : _bufs) {
+    if (!buf.empty()) {
+      _iovecs.push_back({.iov_base = buf.data(), .iov_len = buf.size()});
+    }
+  }
+  return _iovecs;
+}
+
+std::span<iovec> IOBufChain::tail_iovecs() {
+  _iovecs.clear();
+  for (size_t i = tail_start(); i < _bufs.size(); i++) {
+    auto& buf = _bufs[i];
+    if (buf.tailroom() != 0) {
+      _iovecs.push_back({.iov_base = buf.tail(), .iov_len = buf.tailroom()});
+    }
+  }
+  return _iovecs;
+}
+
+void IOBufChain::commit(size_t bytes) {
+  // readv fills the tails in the same order tail_iovecs listed them
+  for (size_t i = tail_start(); i < _bufs.size() && bytes != 0; i++) {
+    auto& buf = _bufs[i];
+    const auto added = std::min(bytes, buf.tailroom());
+    buf.append(added);
+    bytes -= added;
+  }
+}
+
+void IOBufChain::consume(size_t bytes) {
+  size_t drop = 0;
+  for (; drop < _bufs.size(); drop++) {
+    auto& buf = _bufs[drop];
+    if (bytes < buf.size() || (bytes == 0 && buf.tailroom() != 0)) {
+      break;  // keep a partly consumed buffer, or an empty one which can still be read into
+    }
+    bytes -= buf.size();
+  }
+  _bufs.erase(_bufs.begin(), _bufs.begin() + static_cast<std::ptrdiff_t>(drop));
+
+  if (!_bufs.empty()) {
+    _bufs.front().trim_front(bytes);
+  }
+}
+
+IOBufChain IOBufChain::slice(size_t offset, size_t length) const {
+  IOBufChain sliced{};
+  for (auto& buf : _bufs) {
+    if (length == 0) {
+      break;
+    }
+    if (offset >= buf.size()) {
+      offset -= buf.size();
+      continue;
+    }
+
+    auto part = buf.slice(offset, length);
+    length -= part.size();
+    offset = 0;
+    sliced.append(std::move(part));
+  }
+  return sliced;
+}
+
+size_t IOBufChain::copy_to(uint8_t* dest, size_t max_length) const {
+  size_t copied = 0;
+  for (auto& buf : _bufs) {
+    const auto amount = std::min(buf.size(), max_length - copied);
+    std::memcpy(dest + copied, buf.data(), amount);
+    copied += amount;
+    if (copied == max_length) {
+      break;
+    }
+  }
+  return copied;
+}
+
+size_t IOBufChain::size() const {
+  size_t total = 0;
+  for (auto& buf : _bufs) {
+    total += buf.size();
+  }
+  return total;
+}
@@ -0,0 +1,209 @@
+#ifndef IOBUF_
+#define IOBUF_
+
+#include <bits/types/struct_iovec.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+class IOBufPool;
+
+// a fixed size block of memory from a pool, shared by every IOBuf which refers to any part of it
+struct IOBufBlock {
+  uint8_t* data{};
+  uint32_t capacity{};
+  uint32_t refs{};
+  IOBufPool* pool{};
+  IOBufBlock* next_free{};
+};
+
+/*
+Reference counted view of a slice of a pooled block, copying one (or slicing it) shares the block rather
+than the bytes, and the block goes back to its pool once nothing refers to it. Only the loop owning the
+pool may touch these (the counts aren't atomic), and none may outlive the pool
+
+Bytes are added by writing into the tail (past the end of the slice) and then appending them, which is
+only allowed while this is the only reference to the block, since other slices may cover those bytes
+*/
+class IOBuf {
+  IOBufBlock* _block{};
+  uint32_t _offset{};
+  uint32_t _length{};
+
+  void release();
+
+public:
+  IOBuf() = default;
+  explicit IOBuf(IOBufBlock* block) : _block(block) {}
+  ~IOBuf() {
+    release();
+  }
+
+  IOBuf(const IOBuf& other) : _block(other._block), _offset(other._offset), _length(other._length) {
+    if (_block != nullptr) {
+      _block->refs++;
+    }
+  }
+  IOBuf& operator=(const IOBuf& other) {
+    if (this != &other) {
+      IOBuf copy{other};
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+  IOBuf(IOBuf&& other) noexcept
+      : _block(std::exchange(other._block, nullptr)), _offset(std::exchange(other._offset, 0)),
+        _length(std::exchange(other._length, 0)) {}
+  IOBuf& operator=(IOBuf&& other) noexcept {
+    if (this != &other) {
+      release();
+      _block = std::exchange(other._block, nullptr);
+      _offset = std::exchange(other._offset, 0);
+      _length = std::exchange(other._length, 0);
+    }
+    return *this;
+  }
+
+  explicit operator bool() const {
+    return _block != nullptr;
+  }
+  uint8_t* data() const {
+    return _block == nullptr ? nullptr : _block->data + _offset;
+  }
+  size_t size() const {
+    return _length;
+  }
+  bool empty() const {
+    return _length == 0;
+  }
+  bool unique() const {
+    return _block != nullptr && _block->refs == 1;
+  }
+  uint32_t ref_count() const {
+    return _block == nullptr ? 0 : _block->refs;
+  }
+
+  // room to write more bytes into, none while the block is shared
+  uint8_t* tail() const {
+    return data() + _length;
+  }
+  size_t tailroom() const {
+    return unique() ? _block->capacity - _offset - _length : 0;
+  }
+  // extend the slice over bytes written into the tail
+  void append(size_t bytes) {
+    _length += static_cast<uint32_t>(bytes < tailroom() ? bytes : tailroom());
+  }
+
+  void trim_front(size_t bytes) {
+    bytes = bytes < _length ? bytes : _length;
+    _offset += static_cast<uint32_t>(bytes);
+    _length -= static_cast<uint32_t>(bytes);
+  }
+  void trim_back(size_t bytes) {
+    _length -= static_cast<uint32_t>(bytes < _length ? bytes : _length);
+  }
+  // shares the block, the range is clamped to this slice
+  IOBuf slice(size_t offset, size_t length) const;
+
+  void reset() {
+    release();
+  }
+};
+
+/*
+Per loop pool of equally sized blocks for IOBufs, which grows a chunk of blocks at a time and keeps
+released blocks on an intrusive free list, so releasing a buffer (i.e from a completion) never frees
+memory, and allocating only does when the pool has to grow
+*/
+class IOBufPool {
+  static constexpr size_t CHUNK_SIZE = 64;
+  static constexpr uint32_t DEFAULT_BLOCK_SIZE = 16 * 1024;
+
+  uint32_t _block_size{};
+  std::vector<std::unique_ptr<IOBufBlock[]>> _headers{};
+  std::vector<std::unique_ptr<uint8_t[]>> _storage{};
+  IOBufBlock* _free_head{};
+  size_t _num_free{};
+
+  void grow();
+
+public:
+  // a block size of 0 is refused (blocks with no room would never fill a reserve), using 16 KiB instead
+  explicit IOBufPool(uint32_t block_size);
+
+  IOBufPool(const IOBufPool&) = delete;
+  IOBufPool& operator=(const IOBufPool&) = delete;
+
+  // an empty buffer with the whole block as tailroom
+  IOBuf allocate();
+  void recycle(IOBufBlock* block) {
+    block->next_free = _free_head;
+    _free_head = block;
+    _num_free++;
+  }
+
+  uint32_t block_size() const {
+    return _block_size;
+  }
+  size_t capacity() const {
+    return _headers.size() * CHUNK_SIZE;
+  }
+  size_t available() const {
+    return _num_free;
+  }
+};
+
+/*
+Sequence of IOBufs which together hold a stream of bytes (i.e a request read in several goes), which
+readv reads into the tails of and writev writes from, without copying any of it
+*/
+class IOBufChain {
+  std::vector<IOBuf> _bufs{};
+  std::vector<iovec> _iovecs{};
+
+  // the last buffer holding data, only its tailroom and that of the buffers after it can be read into,
+  // since anything earlier would land in the middle of the stream
+  size_t tail_start() const;
+
+public:
+  void append(IOBuf buf) {
+    if (buf) {
+      _bufs.push_back(std::move(buf));
+    }
+  }
+  void append(IOBufChain&& other);
+  // make sure there's at least this much tailroom, taking more buffers from the pool when there isn't
+  void reserve(IOBufPool& pool, size_t bytes);
+
+  // for writev, iovecs over the bytes in the chain, which are valid until it's next changed
+  std::span<iovec> data_iovecs();
+  // for readv, iovecs over the tailroom at the end of the chain, with commit then adding the bytes read
+  std::span<iovec> tail_iovecs();
+  void commit(size_t bytes);
+  // drop bytes from the front (i.e once they've been written), releasing buffers which are then empty
+  void consume(size_t bytes);
+
+  // shares the blocks the range covers, rather than copying them
+  IOBufChain slice(size_t offset, size_t length) const;
+  size_t copy_to(uint8_t* dest, size_t max_length) const;
+
+  size_t size() const;
+  bool empty() const {
+    return size() == 0;
+  }
+  size_t num_buffers() const {
+    return _bufs.size();
+  }
+  IOBuf& buffer(size_t idx) {
+    return _bufs[idx];
+  }
+  void clear() {
+    _bufs.clear();
+  }
+};
+
+#endif
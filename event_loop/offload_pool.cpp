@@ -0,0 +1,84 @@
+#include "offload_pool.hpp"
+#include "event_manager.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <liburing.h>
+
+OffloadPool::OffloadPool(size_t num_threads) {
+  for (size_t i = 0; i < std::max<size_t>(num_threads, 1); i++) {
+    _workers.emplace_back(&OffloadPool::worker_loop, this);
+  }
+}
+
+OffloadPool::~OffloadPool() {
+  {
+    std::scoped_lock<std::mutex> lock{_mutex};
+    _stopping = true;
+  }
+  _cv.notify_all();
+
+  for (auto& worker : _workers) {
+    worker.join();
+  }
+}
+
+void OffloadPool::submit(OffloadJob* job) {
+  {
+    std::scoped_lock<std::mutex> lock{_mutex};
+    _jobs.push_back(job);
+  }
+  _cv.notify_one();
+}
+
+void OffloadPool::worker_loop() {
+  // only ever used to post to other rings, so it never needs to be any bigger
+  io_uring ring{};
+  int ret = io_uring_queue_init(4, &ring, 0);
+  const bool have_ring = ret == 0;
+  if (!have_ring) {
+    // not fatal, finished jobs go back through the home event manager's inbox instead
+    std::cerr << "Unable to setup the offload worker's ring: " << strerror(-ret) << "\n";
+  }
+
+  while (true) {
+    OffloadJob* job = nullptr;
+    {
+      std::unique_lock<std::mutex> lock{_mutex};
+      _cv.wait(lock, [&] { return _stopping || !_jobs.empty(); });
+      if (_jobs.empty()) {
+        break;  // only stop once everything queued has been run
+      }
+      job = _jobs.front();
+      _jobs.pop_front();
+    }
+
+    // copied out first, since the job is part of a coroutine frame which may be gone once it's resumed
+    auto home = job->home;
+    auto handle = job->handle;
+    job->run(job);
+
+    int res = -1;
+    if (have_ring) {
+      auto sqe = io_uring_get_sqe(&ring);
+      auto address = reinterpret_cast<uintptr_t>(handle.address());
+      io_uring_prep_msg_ring(sqe, home->ring_fd(), 0,
+                             RequestTable::make_posted(RequestTable::PostedKind::RESUME, address), 0);
+
+      io_uring_cqe* cqe{};
+      res = io_uring_submit_and_wait(&ring, 1);
+      if (res >= 0 && io_uring_peek_cqe(&ring, &cqe) == 0) {
+        res = cqe->res;
+        io_uring_cqe_seen(&ring, cqe);
+      }
+    }
+
+    if (res < 0) {
+      home->enqueue_call([handle](EventManager* ev) { ev->schedule(handle); });
+    }
+  }
+
+  if (have_ring) {
+    io_uring_queue_exit(&ring);
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef OFFLOAD_POOL_
+#define OFFLOAD_POOL_
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class EventManager;
+
+// a piece of blocking work, which lives in the awaiting coroutine's frame (see OffloadAwaitable)
+struct OffloadJob {
+  void (*run)(OffloadJob* job){};
+  EventManager* home{};
+  std::coroutine_handle<> handle{};
+};
+
+/*
+Fixed number of worker threads for blocking or CPU heavy work, so it doesn't stall an event loop
+
+Once a job has run, the worker posts a completion to the home event manager's ring (each worker has
+a tiny ring of its own just for IORING_OP_MSG_RING), which resumes the awaiting coroutine on its
+loop, so the loop never has to poll for finished jobs
+*/
+class OffloadPool {
+  std::mutex _mutex{};
+  std::condition_variable _cv{};
+  std::deque<OffloadJob*> _jobs{};
+  bool _stopping{};
+  std::vector<std::thread> _workers{};
+
+  void worker_loop();
+
+public:
+  explicit OffloadPool(size_t num_threads);
+  ~OffloadPool();
+
+  OffloadPool(const OffloadPool&) = delete;
+  OffloadPool& operator=(const OffloadPool&) = delete;
+
+  void submit(OffloadJob* job);
+  size_t num_threads() const {
+    return _workers.size();
+  }
+};
+
+#endif
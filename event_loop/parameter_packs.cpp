@@ -48,4 +48,25 @@ void RequestQueue::queue_unlinkat(int dirfd, const char* pathname, int flags) {
 void RequestQueue::queue_renameat(int olddirfd, const char* oldpathname, int newdirfd,
                                   const char* newpathname, int flags) {
   req_vec.push_back(RenameatParameterPack{olddirfd, oldpathname, newdirfd, newpathname, flags});
-}
\ No newline at end of file
+}
+void RequestQueue::queue_msg_ring(EventManager* target, uint64_t data, int32_t value) {
+  req_vec.push_back(MsgRingParameterPack{.data = data, .value = value, .target = target});
+}
+
+void RequestQueue::queue_recv_provided(int sockfd, ProvidedBufferRing* buffers, int flags) {
+  req_vec.push_back(RecvProvidedParameterPack{sockfd, buffers, flags});
+}
+
+void RequestQueue::queue_read_fixed(int fd, unsigned buf_index, size_t buf_offset, size_t length,
+                                    uint64_t offset) {
+  req_vec.push_back(ReadFixedParameterPack{fd, buf_index, buf_offset, length, offset});
+}
+
+void RequestQueue::queue_write_fixed(int fd, unsigned buf_index, size_t buf_offset, size_t length,
+                                     uint64_t offset) {
+  req_vec.push_back(WriteFixedParameterPack{fd, buf_index, buf_offset, length, offset});
+}
+
+void RequestQueue::queue_socket(int domain, int type, int protocol) {
+  req_vec.push_back(SocketParameterPack{domain, type, protocol});
+}
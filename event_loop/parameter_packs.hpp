@@ -13,16 +13,19 @@ struct ReadParameterPack {
   int fd{};
   uint8_t* buffer{};
   size_t length{};
+  uint64_t offset{};
 };
 
 struct WriteParameterPack {
   int fd{};
   const uint8_t* buffer{};
   size_t length{};
+  uint64_t offset{};
 };
 
 struct CloseParameterPack {
   int fd{};
+  bool direct{};  // fd is a slot in the direct file table
 };
 
 struct ShutdownParameterPack {
@@ -46,6 +49,7 @@ struct AcceptParameterPack {
   int sockfd{};
   sockaddr* addr{};
   socklen_t* addrlen{};
+  bool direct{};  // the accepted socket goes in the direct file table
 };
 
 struct ConnectParameterPack {
@@ -59,6 +63,7 @@ struct OpenatParameterPack {
   const char* pathname{};
   int flags{};
   mode_t mode{};
+  bool direct{};  // the opened file goes in the direct file table
 };
 
 struct StatxParameterPack {
@@ -83,10 +88,70 @@ struct RenameatParameterPack {
   int flags{};
 };
 
+class EvTask;
+
+// posts a completion to another ring, carrying either a message or a task for it to run
+class EventManager;
+
+struct MsgRingParameterPack {
+  int ring_fd{};
+  uint64_t data{};          // only the low 56 bits make it across (see request_table.hpp)
+  int32_t value{};          // arrives as the completion's res
+  EvTask* task{};           // owned by the request until the other ring has it
+  EventManager* target{};   // for batched posts, which only go out while it's open to posts
+};
+
+class ProvidedBufferRing;
+
+// recv into whichever buffer of the ring the kernel picks once data arrives
+struct RecvProvidedParameterPack {
+  int sockfd{};
+  ProvidedBufferRing* buffers{};
+  int flags{};
+};
+
+// read or write through a registered buffer, buffer is where buf_offset into that buffer is, which the
+// event manager fills in when it prepares the operation
+struct ReadFixedParameterPack {
+  int fd{};
+  unsigned buf_index{};
+  size_t buf_offset{};
+  size_t length{};
+  uint64_t offset{};
+  uint8_t* buffer{};
+};
+
+struct WriteFixedParameterPack {
+  int fd{};
+  unsigned buf_index{};
+  size_t buf_offset{};
+  size_t length{};
+  uint64_t offset{};
+  const uint8_t* buffer{};
+};
+
+struct SocketParameterPack {
+  int domain{};
+  int type{};
+  int protocol{};
+  bool direct{};  // the socket goes in the direct file table
+};
+
+class AcceptStream;
+
+// one accept which keeps posting a completion per connection, only armed by an AcceptStream
+struct AcceptMultishotParameterPack {
+  int sockfd{};
+  bool direct{};  // the accepted sockets go in the direct file table
+  AcceptStream* stream{};
+};
+
 using OperationParameterPackVariant =
     std::variant<ReadParameterPack, WriteParameterPack, CloseParameterPack, ShutdownParameterPack,
                  ReadvParameterPack, WritevParameterPack, AcceptParameterPack, ConnectParameterPack,
-                 OpenatParameterPack, StatxParameterPack, UnlinkatParameterPack, RenameatParameterPack>;
+                 OpenatParameterPack, StatxParameterPack, UnlinkatParameterPack, RenameatParameterPack,
+                 MsgRingParameterPack, RecvProvidedParameterPack, ReadFixedParameterPack,
+                 WriteFixedParameterPack, SocketParameterPack, AcceptMultishotParameterPack>;
 
 template <RequestType>
 struct RequestToParamPack;
@@ -151,6 +216,36 @@ struct RequestToParamPack<RequestType::RENAMEAT> {
   using type = RenameatParameterPack;
 };
 
+template <>
+struct RequestToParamPack<RequestType::MSG_RING> {
+  using type = MsgRingParameterPack;
+};
+
+template <>
+struct RequestToParamPack<RequestType::RECV_PROVIDED> {
+  using type = RecvProvidedParameterPack;
+};
+
+template <>
+struct RequestToParamPack<RequestType::READ_FIXED> {
+  using type = ReadFixedParameterPack;
+};
+
+template <>
+struct RequestToParamPack<RequestType::WRITE_FIXED> {
+  using type = WriteFixedParameterPack;
+};
+
+template <>
+struct RequestToParamPack<RequestType::SOCKET> {
+  using type = SocketParameterPack;
+};
+
+template <>
+struct RequestToParamPack<RequestType::ACCEPT_MULTISHOT> {
+  using type = AcceptMultishotParameterPack;
+};
+
 using RequestOpVec = std::vector<OperationParameterPackVariant>;
 
 struct RequestQueue {
@@ -169,6 +264,11 @@ struct RequestQueue {
   void queue_unlinkat(int dirfd, const char* pathname, int flags);
   void queue_renameat(int olddirfd, const char* oldpathname, int newdirfd, const char* newpathname,
                       int flags);
+  void queue_msg_ring(EventManager* target, uint64_t data, int32_t value);
+  void queue_recv_provided(int sockfd, ProvidedBufferRing* buffers, int flags = 0);
+  void queue_read_fixed(int fd, unsigned buf_index, size_t buf_offset, size_t length, uint64_t offset = 0);
+  void queue_write_fixed(int fd, unsigned buf_index, size_t buf_offset, size_t length, uint64_t offset = 0);
+  void queue_socket(int domain, int type, int protocol);
 };
 
 #endif
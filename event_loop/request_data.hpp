@@ -10,10 +10,13 @@
 
 struct RequestData {
   EvTask::Handle handle{};
-  uint64_t coro_idx{};    // index in the managed coroutines vector in the event manager
+  uint64_t coro_idx{};    // key in the managed coroutines store in the event manager
   bool* coro_finished{};  // pointer to a field in a task_status object managed as a unique ptr
   RequestType req_type{};
-  bool allocated_dynamic{false};
+  bool pooled{false};  // taken from the event manager's pool, and given back once it's been handled
+  uint32_t cqe_flags{};  // from the completion, i.e which provided buffer was used
+  bool fixed_file{};     // the operation's fd is a slot in the direct file table
+  bool orphaned{};       // stands in for a forgotten request, to give back whatever its completion holds
 
   union {
     ReadParameterPack read_data;
@@ -28,6 +31,12 @@ struct RequestData {
     StatxParameterPack statx_data;
     UnlinkatParameterPack unlinkat_data;
     RenameatParameterPack renameat_data;
+    MsgRingParameterPack msg_ring_data;
+    RecvProvidedParameterPack recv_provided_data;
+    ReadFixedParameterPack read_fixed_data;
+    WriteFixedParameterPack write_fixed_data;
+    SocketParameterPack socket_data;
+    AcceptMultishotParameterPack accept_multishot_data;
   } specific_data{};
 };
 
@@ -0,0 +1,159 @@
+#ifndef REQUEST_TABLE_
+#define REQUEST_TABLE_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "event_loop/request_data.hpp"
+
+/*
+The user_data of every SQE refers to an entry in this table rather than pointing straight at the
+request's data, laid out as:
+  | generation (24 bits) | op kind (8 bits) | table index (32 bits) |
+
+An entry's generation is bumped every time it is freed, so a completion for a request which has
+since been released or forgotten (i.e its awaitable was destroyed) simply doesn't resolve, instead
+of leading to a dangling pointer. Generations start at 1, so a user_data of 0 never resolves and
+can be used for requests whose completions should be ignored
+
+Completions posted to this ring by another one (IORING_OP_MSG_RING) aren't in the table at all,
+they use op kinds which no request has (a message, a task to start, a coroutine to resume, or just
+a wakeup), and carry 56 bits of payload in the rest of the user_data:
+  | payload bits 32-55 (24 bits) | posted kind (8 bits) | payload bits 0-31 (32 bits) |
+*/
+class RequestTable {
+  static constexpr uint32_t NO_FREE_ENTRY = UINT32_MAX;
+  static constexpr uint32_t GENERATION_MASK = (1U << 24) - 1;
+
+  struct Entry {
+    RequestData* req_data{};
+    uint32_t tag{};  // generation and op kind, same as the upper half of the user_data
+    uint32_t next_free{NO_FREE_ENTRY};
+  };
+
+  std::vector<Entry> _entries{};
+  uint32_t _free_head{NO_FREE_ENTRY};
+  size_t _size{};
+
+  static uint32_t make_tag(uint32_t generation, RequestType kind) {
+    return (generation << 8) | static_cast<uint8_t>(kind);
+  }
+
+  Entry* entry_for(uint64_t user_data) {
+    auto idx = static_cast<uint32_t>(user_data);
+    if (idx >= _entries.size()) {
+      return nullptr;
+    }
+
+    auto& entry = _entries[idx];
+    if (entry.req_data == nullptr || entry.tag != static_cast<uint32_t>(user_data >> 32)) {
+      return nullptr;
+    }
+    return &entry;
+  }
+
+public:
+  enum class PostedKind : uint8_t { MESSAGE = 0xFF, TASK = 0xFE, RESUME = 0xFD, WAKEUP = 0xFC };
+  static constexpr uint64_t MAX_POSTED_PAYLOAD = (1ULL << 56) - 1;
+
+  // the event manager's own read on its inbox eventfd, whose kind is neither a request's nor a posted one
+  static constexpr uint64_t INBOX_READ_USER_DATA = 0xFBULL << 32;
+
+  static uint64_t make_posted(PostedKind kind, uint64_t payload) {
+    return ((payload >> 32) << 40) | (static_cast<uint64_t>(kind) << 32) | (payload & UINT32_MAX);
+  }
+
+  static bool is_posted(uint64_t user_data) {
+    return static_cast<uint8_t>(user_data >> 32) >= static_cast<uint8_t>(PostedKind::WAKEUP);
+  }
+
+  static PostedKind posted_kind(uint64_t user_data) {
+    return static_cast<PostedKind>(static_cast<uint8_t>(user_data >> 32));
+  }
+
+  static uint64_t posted_payload(uint64_t user_data) {
+    return ((user_data >> 40) << 32) | (user_data & UINT32_MAX);
+  }
+
+  // the user_data the other ring's completion gets for a MSG_RING request
+  static uint64_t posted_user_data(const MsgRingParameterPack& pack) {
+    if (pack.task != nullptr) {
+      return make_posted(PostedKind::TASK, reinterpret_cast<uintptr_t>(pack.task));
+    }
+    return make_posted(PostedKind::MESSAGE, pack.data);
+  }
+
+  static RequestType op_kind(uint64_t user_data) {
+    return static_cast<RequestType>(static_cast<uint8_t>(user_data >> 32));
+  }
+
+  void reserve(size_t num_entries) {
+    _entries.reserve(num_entries);
+  }
+
+  // returns the user_data to set on the SQE
+  uint64_t insert(RequestData* req_data) {
+    if (_free_head == NO_FREE_ENTRY) {
+      _entries.push_back({.tag = make_tag(1, req_data->req_type)});
+      _free_head = static_cast<uint32_t>(_entries.size() - 1);
+    }
+
+    auto idx = _free_head;
+    auto& entry = _entries[idx];
+    _free_head = entry.next_free;
+
+    entry.req_data = req_data;
+    entry.tag = make_tag(entry.tag >> 8, req_data->req_type);
+    entry.next_free = NO_FREE_ENTRY;
+    _size++;
+
+    return (static_cast<uint64_t>(entry.tag) << 32) | idx;
+  }
+
+  // nullptr if the user_data is stale, leaves the entry in place (i.e for multishot requests)
+  RequestData* resolve(uint64_t user_data) {
+    auto entry = entry_for(user_data);
+    return entry == nullptr ? nullptr : entry->req_data;
+  }
+
+  // points a live entry at different data (i.e an orphan standing in for a request whose awaitable is
+  // gone), returns false if the user_data is stale
+  bool replace(uint64_t user_data, RequestData* req_data) {
+    auto entry = entry_for(user_data);
+    if (entry == nullptr) {
+      return false;
+    }
+    entry->req_data = req_data;
+    return true;
+  }
+
+  // resolves the user_data and frees its entry, so any further completions for it are ignored
+  RequestData* release(uint64_t user_data) {
+    auto entry = entry_for(user_data);
+    if (entry == nullptr) {
+      return nullptr;
+    }
+
+    auto req_data = entry->req_data;
+    uint32_t generation = ((entry->tag >> 8) + 1) & GENERATION_MASK;
+    if (generation == 0) {
+      generation = 1;  // keep 0 invalid when the generation wraps around
+    }
+
+    entry->req_data = nullptr;
+    entry->tag = make_tag(generation, RequestType{});
+    entry->next_free = _free_head;
+    _free_head = static_cast<uint32_t>(user_data);
+    _size--;
+
+    return req_data;
+  }
+
+  // number of requests currently in the table
+  size_t size() const {
+    return _size;
+  }
+};
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef WORK_STEALING_
+#define WORK_STEALING_
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+Chase-Lev work stealing deque of ready coroutines (using the C11 memory orderings from Lê et al,
+"Correct and Efficient Work-Stealing for Weak Memory Models")
+
+Only the owning loop's thread may push and pop, which work on the bottom end (so the owner gets
+the most recently pushed, cache warm, coroutine first), while any thread may steal from the top.
+The buffer grows when full, and old buffers are only freed along with the deque, since a thief
+may still be reading from one
+*/
+class WorkStealingDeque {
+  struct Buffer {
+    int64_t mask{};
+    std::unique_ptr<std::atomic<void*>[]> slots{};
+
+    explicit Buffer(int64_t capacity)
+        : mask(capacity - 1), slots(std::make_unique<std::atomic<void*>[]>(capacity)) {}
+
+    int64_t capacity() const {
+      return mask + 1;
+    }
+    void* get(int64_t idx) const {
+      return slots[idx & mask].load(std::memory_order_relaxed);
+    }
+    void put(int64_t idx, void* item) {
+      slots[idx & mask].store(item, std::memory_order_relaxed);
+    }
+  };
+
+  alignas(64) std::atomic<int64_t> _top{};
+  alignas(64) std::atomic<int64_t> _bottom{};
+  std::atomic<Buffer*> _buffer{};
+  std::vector<std::unique_ptr<Buffer>> _buffers{};  // owner only, every buffer ever used
+
+  Buffer* grow(Buffer* old, int64_t top, int64_t bottom) {
+    auto& bigger = _buffers.emplace_back(std::make_unique<Buffer>(old->capacity() * 2));
+    for (int64_t i = top; i < bottom; i++) {
+      bigger->put(i, old->get(i));
+    }
+    _buffer.store(bigger.get(), std::memory_order_release);
+    return bigger.get();
+  }
+
+public:
+  // capacity must be a power of two
+  explicit WorkStealingDeque(int64_t capacity = 64) {
+    _buffers.push_back(std::make_unique<Buffer>(capacity));
+    _buffer.store(_buffers.back().get(), std::memory_order_relaxed);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  // owner only
+  void push(std::coroutine_handle<> handle) {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed);
+    int64_t top = _top.load(std::memory_order_acquire);
+    auto buffer = _buffer.load(std::memory_order_relaxed);
+    if (bottom - top > buffer->capacity() - 1) {
+      buffer = grow(buffer, top, bottom);
+    }
+
+    buffer->put(bottom, handle.address());
+    _bottom.store(bottom + 1, std::memory_order_release);  // publishes the item (and the frame) to thieves
+  }
+
+  // owner only, a null handle if it's empty
+  std::coroutine_handle<> pop() {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    auto buffer = _buffer.load(std::memory_order_relaxed);
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = _top.load(std::memory_order_relaxed);
+
+    void* item = nullptr;
+    if (top <= bottom) {
+      item = buffer->get(bottom);
+      if (top == bottom) {
+        // the last item, so race any thieves for it
+        if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+          item = nullptr;
+        }
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+      }
+    } else {
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return std::coroutine_handle<>::from_address(item);
+  }
+
+  // any thread, a null handle if it's empty or another thread got there first
+  std::coroutine_handle<> steal() {
+    int64_t top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = _bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+      return {};
+    }
+
+    auto buffer = _buffer.load(std::memory_order_acquire);
+    void* item = buffer->get(top);
+    if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return {};
+    }
+    return std::coroutine_handle<>::from_address(item);
+  }
+
+  // only a snapshot when called by a thief, exact for the owner
+  size_t size() const {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed);
+    int64_t top = _top.load(std::memory_order_relaxed);
+    return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+  }
+};
+
+class EventManager;
+
+/*
+Set of event managers (each running its loop on its own thread) which steal migratable coroutines
+from each other when they would otherwise go to sleep. Members are added before their loops start,
+and the group, along with every member, has to outlive all of the members' loops
+*/
+class WorkStealingGroup {
+  std::unique_ptr<std::atomic<EventManager*>[]> _members{};
+  size_t _max_members{};
+  std::atomic<size_t> _num_members{};
+
+public:
+  explicit WorkStealingGroup(size_t max_members)
+      : _members(std::make_unique<std::atomic<EventManager*>[]>(max_members)), _max_members(max_members) {}
+
+  // safe to call while other members' loops are running, returns false if the group is full
+  bool add(EventManager* ev) {
+    auto idx = _num_members.fetch_add(1);
+    if (idx >= _max_members) {
+      _num_members.fetch_sub(1);
+      return false;
+    }
+    _members[idx].store(ev, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    auto num = _num_members.load(std::memory_order_acquire);
+    return num < _max_members ? num : _max_members;
+  }
+
+  // nullptr for a slot which has been claimed but not filled in yet
+  EventManager* member(size_t idx) const {
+    return _members[idx].load(std::memory_order_acquire);
+  }
+};
+
+#endif
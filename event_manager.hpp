@@ -2,6 +2,7 @@
 #define EVENT_MANAGER_HEAD_INCLUDE_
 
 #include "coroutine/io_awaitables.hpp"
+#include "event_loop/accept_stream.hpp"
 #include "event_loop/event_manager.hpp"
 
 #endif
\ No newline at end of file
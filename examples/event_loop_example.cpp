@@ -119,6 +119,24 @@ EvTask coro(EventManager* ev) {
     case RequestType::RENAMEAT: {
       break;
     };
+    case RequestType::MSG_RING: {
+      break;
+    };
+    case RequestType::RECV_PROVIDED: {
+      break;
+    };
+    case RequestType::READ_FIXED: {
+      break;
+    };
+    case RequestType::WRITE_FIXED: {
+      break;
+    };
+    case RequestType::SOCKET: {
+      break;
+    };
+    case RequestType::ACCEPT_MULTISHOT: {
+      break;
+    };
     }
   });
 
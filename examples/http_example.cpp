@@ -1,5 +1,6 @@
 #include "coroutine/io_awaitables.hpp"
 #include "errors.hpp"
+#include "event_loop/accept_stream.hpp"
 #include "event_loop/event_manager.hpp"
 #include <cstring>
 #include <fcntl.h>
@@ -155,12 +156,15 @@ EvTask send_hello_world(EventManager* ev, int user_fd) {
 EvTask coro(EventManager* ev) {
   int listener_fd = setup_listener(3050);
 
+  // one multishot accept for every connection, rather than an accept per connection
+  AcceptStream connections{ev, listener_fd};
   while (true) {
-    sockaddr addr{};
-    socklen_t addrlen = sizeof(addr);
-    int fd = (co_await ev->accept(listener_fd, &addr, &addrlen)).data.fd;
+    auto res = co_await connections.next();
+    if (ErrorProcessing::is_there_an_error(res.error)) {
+      break;
+    }
 
-    ev->register_coro(send_hello_world, ev, fd);
+    ev->register_coro(send_hello_world, ev, res.data.fd);
   }
 
   co_await ev->close(listener_fd);
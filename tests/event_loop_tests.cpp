@@ -2,8 +2,15 @@
 #include "vendor/doctest/doctest/doctest.h"
 
 #include "event_manager.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <fcntl.h>
+#include <netinet/in.h>
+#include <stdexcept>
 #include <thread>
+#include <unistd.h>
 
 const std::string LOREM_IPSUM = R"(Lorem ipsum dolor sit amet, consectetur adipiscing elit. Aenean ultricies
 ex sit amet orci tincidunt, a viverra sem suscipit. Phasellus non quam
@@ -117,4 +124,1366 @@ TEST_CASE("Testing variety of event loop capabilities") {
   ev.start();
 
   REQUIRE(output.rdbuf()->str() == EXPECTED_OUTPUT);
-}
\ No newline at end of file
+}
+
+EvTask batch_coro(EventManager* ev, size_t* num_handled) {
+  int fd = open("/dev/null", O_WRONLY);
+
+  auto queue = ev->make_request_queue();
+  for (size_t i = 0; i < 5; i++) {
+    queue.queue_write(fd, get_write_data(LOREM_IPSUM), LOREM_IPSUM.length());
+  }
+
+  co_await ev->submit_and_wait(queue, [&](RequestType req_type, CommunicationChannel* channel) {
+    if (req_type == RequestType::WRITE) {
+      auto data = channel->consume_resp_data<RequestType::WRITE>();
+      if (data.has_value() && data->bytes_wrote == LOREM_IPSUM.length()) {
+        (*num_handled)++;
+      }
+    }
+  });
+
+  close(fd);
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Completions that are ready together are harvested in one wakeup") {
+  size_t num_handled = 0;
+  EventManager ev(10);
+
+  ev.register_coro(batch_coro(&ev, &num_handled));
+  ev.start();
+
+  REQUIRE(num_handled == 5);
+  REQUIRE(ev.stats().cqes_processed >= 5);
+  REQUIRE(ev.stats().max_batch_size > 1);
+  REQUIRE(ev.stats().wakeups < ev.stats().cqes_processed);
+}
+
+EvTask deferred_write_coro(EventManager* ev, int fd, size_t* remaining) {
+  co_await ev->write(fd, get_write_data(LOREM_IPSUM), LOREM_IPSUM.length());
+  if (--(*remaining) == 0) {
+    co_await ev->kill();
+  }
+  co_return 0;
+}
+
+TEST_CASE("Deferred submission coalesces submissions from many coroutines") {
+  constexpr size_t NUM_COROS = 8;
+  size_t remaining = NUM_COROS;
+  int fd = open("/dev/null", O_WRONLY);
+
+  EventManager ev(16, {.submission_mode = SubmissionMode::DEFERRED});
+  for (size_t i = 0; i < NUM_COROS; i++) {
+    ev.register_coro(deferred_write_coro(&ev, fd, &remaining));
+  }
+  ev.start();
+  close(fd);
+
+  REQUIRE(remaining == 0);
+  REQUIRE(ev.stats().submit_calls < NUM_COROS);
+}
+
+TEST_CASE("Operations complete with kernel side submission queue polling") {
+  constexpr size_t NUM_COROS = 4;
+  size_t remaining = NUM_COROS;
+  int fd = open("/dev/null", O_WRONLY);
+
+  EventManager ev(16, {.sq_poll = true, .sq_thread_idle_ms = 10});
+  for (size_t i = 0; i < NUM_COROS; i++) {
+    ev.register_coro(deferred_write_coro(&ev, fd, &remaining));
+  }
+  ev.start();
+  close(fd);
+
+  REQUIRE(remaining == 0);
+}
+
+TEST_CASE("Operations complete on a single issuer ring with deferred task running") {
+  constexpr size_t NUM_COROS = 4;
+  size_t remaining = NUM_COROS;
+  int fd = open("/dev/null", O_WRONLY);
+
+  EventManager ev(16, {.submission_mode = SubmissionMode::DEFERRED,
+                       .defer_taskrun = true,
+                       .taskrun_flag = true,
+                       .submit_all = true,
+                       .cq_entries = 64,
+                       .register_ring_fd = true});
+  for (size_t i = 0; i < NUM_COROS; i++) {
+    ev.register_coro(deferred_write_coro(&ev, fd, &remaining));
+  }
+  ev.start();
+  close(fd);
+
+  REQUIRE(remaining == 0);
+}
+
+TEST_CASE("Operations wait for a free SQE instead of failing when the queue is full") {
+  constexpr size_t NUM_COROS = 16;
+  size_t remaining = NUM_COROS;
+  int fd = open("/dev/null", O_WRONLY);
+
+  // every coroutine queues its write before the loop first submits, which overflows the 2 entry queue
+  EventManager ev(2, {.submission_mode = SubmissionMode::DEFERRED});
+  for (size_t i = 0; i < NUM_COROS; i++) {
+    ev.register_coro(deferred_write_coro(&ev, fd, &remaining));
+  }
+  ev.start();
+  close(fd);
+
+  REQUIRE(remaining == 0);
+  REQUIRE(ev.stats().sqe_waits > 0);
+}
+
+TEST_CASE("Spinning wait policies pick up completions without sleeping") {
+  for (auto policy : {WaitPolicy::SPIN_THEN_BLOCK, WaitPolicy::SPIN_THEN_TIMEOUT}) {
+    constexpr size_t NUM_COROS = 4;
+    size_t remaining = NUM_COROS;
+    int fd = open("/dev/null", O_WRONLY);
+
+    EventManager ev(16, {.submission_mode = SubmissionMode::DEFERRED,
+                         .wait_policy = policy,
+                         .spin_budget_ns = 1'000'000,
+                         .spin_budget_iterations = 100'000,
+                         .wait_timeout_us = 1000});
+    for (size_t i = 0; i < NUM_COROS; i++) {
+      ev.register_coro(deferred_write_coro(&ev, fd, &remaining));
+    }
+    ev.start();
+    close(fd);
+
+    REQUIRE(remaining == 0);
+    REQUIRE(ev.stats().spin_hits > 0);
+  }
+}
+
+EvTask read_then_kill_coro(EventManager* ev, int fd) {
+  uint8_t byte{};
+  co_await ev->read(fd, &byte, 1);
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("A zero wait timeout blocks rather than busy spinning") {
+  int fds[2]{};
+  REQUIRE(pipe(fds) == 0);
+
+  EventManager ev(8, {.wait_policy = WaitPolicy::SPIN_THEN_TIMEOUT,
+                      .spin_budget_iterations = 10,
+                      .wait_timeout_us = 0});
+  ev.register_coro(read_then_kill_coro(&ev, fds[0]));
+  std::thread writer([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE(write(fds[1], "x", 1) == 1);
+  });
+  ev.start();
+  writer.join();
+  close(fds[0]);
+  close(fds[1]);
+
+  // waking up for every timeout would have the loop go round (and to sleep) thousands of times
+  REQUIRE(ev.stats().sleeps < 100);
+}
+
+struct PolledFileResults {
+  size_t num_completed{};
+  int write_error{};
+  int read_error{};
+  size_t bytes_wrote{};
+  size_t bytes_read{};
+  bool contents_match{};
+};
+
+EvTask polled_file_coro(EventManager* ev, int fd, uint8_t* block, size_t block_size,
+                        PolledFileResults* results) {
+  std::memset(block, 'x', block_size);
+  auto write_resp = co_await ev->write_polled(fd, block, block_size, 0);
+  results->num_completed++;
+  results->write_error = write_resp.data.error_num;
+
+  // devices without poll queues fail polled requests (i.e with EOPNOTSUPP), but they still complete
+  if (!ErrorProcessing::is_there_an_error(write_resp.error)) {
+    results->bytes_wrote = write_resp.data.bytes_wrote;
+    std::memset(block, 0, block_size);
+    auto read_resp = co_await ev->read_polled(fd, block, block_size, 0);
+    results->num_completed++;
+    results->read_error = read_resp.data.error_num;
+
+    if (!ErrorProcessing::is_there_an_error(read_resp.error)) {
+      results->bytes_read = read_resp.data.bytes_read;
+      results->contents_match = block[0] == 'x' && block[block_size - 1] == 'x';
+    }
+  }
+
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Polled O_DIRECT file operations complete through the IOPOLL ring") {
+  constexpr size_t DIRECT_IO_SIZE = 4096;
+  const char* path = "polled_file_test.tmp";
+
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+  if (fd < 0) {
+    MESSAGE("Skipped, the filesystem doesn't support O_DIRECT (i.e tmpfs): " << strerror(errno));
+    return;
+  }
+  unlink(path);
+
+  auto block = static_cast<uint8_t*>(std::aligned_alloc(DIRECT_IO_SIZE, DIRECT_IO_SIZE));
+  PolledFileResults results{};
+
+  EventManager ev(8, {.polled_queue_depth = 8});
+  ev.register_coro(polled_file_coro(&ev, fd, block, DIRECT_IO_SIZE, &results));
+  ev.start();
+  close(fd);
+  std::free(block);
+
+  REQUIRE(results.num_completed >= 1);
+  REQUIRE(ev.stats().polled_cqes == results.num_completed);
+  if (results.write_error != 0) {
+    MESSAGE("Only checked the write completes, the device can't poll: " << strerror(results.write_error));
+    return;
+  }
+  REQUIRE(results.bytes_wrote == DIRECT_IO_SIZE);
+  if (results.read_error != 0) {
+    MESSAGE("Only checked the read completes, the device can't poll: " << strerror(results.read_error));
+    return;
+  }
+  REQUIRE(results.bytes_read == DIRECT_IO_SIZE);
+  REQUIRE(results.contents_match);
+}
+
+EvTask yielding_coro(EventManager* ev, char id, std::string* order, size_t* remaining) {
+  for (size_t i = 0; i < 3; i++) {
+    order->push_back(id);
+    co_await ev->yield();
+  }
+
+  if (--(*remaining) == 0) {
+    co_await ev->kill();
+  }
+  co_return 0;
+}
+
+TEST_CASE("Yielding coroutines take turns on the run queue") {
+  std::string order{};
+  size_t remaining = 2;
+
+  EventManager ev(8, {.max_resumes_per_tick = 1});
+  ev.register_coro(yielding_coro(&ev, 'a', &order, &remaining));
+  ev.register_coro(yielding_coro(&ev, 'b', &order, &remaining));
+  ev.start();
+
+  REQUIRE(order == "ababab");
+  REQUIRE(ev.stats().resumes >= 6);
+  REQUIRE(ev.stats().wakeups >= 6);
+}
+
+TEST_CASE("Item store keys go stale once their item is erased") {
+  ItemStore<std::string> store{};
+
+  auto first = store.insert("first");
+  auto second = store.insert("second");
+  REQUIRE(store.size() == 2);
+  REQUIRE(*store.get(first) == "first");
+
+  std::string* second_addr = store.get(second);
+  REQUIRE(store.erase(first));
+  REQUIRE(!store.erase(first));
+  REQUIRE(store.get(first) == nullptr);
+  REQUIRE(store.get(0) == nullptr);
+
+  // the freed slot is reused first, but under a new generation
+  auto third = store.insert("third");
+  REQUIRE(static_cast<uint32_t>(third) == static_cast<uint32_t>(first));
+  REQUIRE(third != first);
+  REQUIRE(store.get(first) == nullptr);
+  REQUIRE(*store.get(third) == "third");
+
+  // growing never moves what's already stored
+  std::vector<uint64_t> keys{};
+  for (size_t i = 0; i < 1000; i++) {
+    keys.push_back(store.insert(std::to_string(i)));
+  }
+  REQUIRE(store.get(second) == second_addr);
+  REQUIRE(*store.get(keys[999]) == "999");
+  REQUIRE(store.size() == 1002);
+}
+
+TEST_CASE("Request table user data goes stale once released") {
+  RequestTable table{};
+  RequestData first_req{.req_type = RequestType::READ};
+  RequestData second_req{.req_type = RequestType::WRITE};
+
+  auto first = table.insert(&first_req);
+  auto second = table.insert(&second_req);
+  REQUIRE(RequestTable::op_kind(first) == RequestType::READ);
+  REQUIRE(RequestTable::op_kind(second) == RequestType::WRITE);
+  REQUIRE(table.resolve(first) == &first_req);
+  REQUIRE(table.resolve(0) == nullptr);
+
+  REQUIRE(table.release(first) == &first_req);
+  REQUIRE(table.release(first) == nullptr);
+  REQUIRE(table.resolve(first) == nullptr);
+
+  // the freed entry is reused, but under a new generation
+  auto third = table.insert(&second_req);
+  REQUIRE(static_cast<uint32_t>(third) == static_cast<uint32_t>(first));
+  REQUIRE(table.resolve(first) == nullptr);
+  REQUIRE(table.resolve(third) == &second_req);
+  REQUIRE(table.size() == 2);
+}
+
+EvTask blocked_read_coro(EventManager* ev, int fd, uint8_t* buffer) {
+  co_await ev->read(fd, buffer, 1);
+  co_return 0;
+}
+
+EvTask placeholder_coro() {
+  co_return 0;
+}
+
+EvTask yield_then_kill_coro(EventManager* ev) {
+  co_await ev->yield();
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Completions for requests of destroyed coroutines are ignored") {
+  int fds[2]{};
+  REQUIRE(pipe(fds) == 0);
+  uint8_t buffer[1]{};
+
+  EventManager ev(8);
+  auto task = blocked_read_coro(&ev, fds[0], buffer);
+  task.start();
+
+  // destroys the suspended coroutine (and its awaitable) with the read still in flight
+  task = placeholder_coro();
+  task.start();
+  REQUIRE(write(fds[1], "x", 1) == 1);
+
+  ev.register_coro(yield_then_kill_coro(&ev));
+  ev.start();
+  close(fds[0]);
+  close(fds[1]);
+
+  REQUIRE(ev.stats().stale_cqes == 1);
+}
+
+struct PostingResults {
+  std::vector<uint64_t> received{};
+  std::thread::id task_thread{};
+  PostedMessage reply{};
+};
+
+EvTask posted_task(EventManager* ev, EventManager* reply_to, PostingResults* results) {
+  results->task_thread = std::this_thread::get_id();
+  co_await ev->post_message(reply_to, 42, 7);
+  co_await ev->kill();
+  co_return 0;
+}
+
+EvTask receiving_coro(EventManager* ev, PostingResults* results) {
+  for (size_t i = 0; i < 2; i++) {
+    auto message = co_await ev->receive_message();
+    results->received.push_back(message.data);
+  }
+  co_return 0;
+}
+
+EvTask posting_coro(EventManager* ev, EventManager* target, PostingResults* results) {
+  co_await ev->post_message(target, 1);
+  co_await ev->post_message(target, 2);
+  auto res = co_await ev->post_task(target, posted_task(target, ev, results));
+  if (!ErrorProcessing::is_there_an_error(res.error)) {
+    results->reply = co_await ev->receive_message();
+  }
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Messages and tasks posted to another event manager's ring run on its thread") {
+  PostingResults results{};
+
+  EventManager receiver(8);
+  EventManager sender(8);
+  receiver.register_coro(receiving_coro(&receiver, &results));
+  sender.register_coro(posting_coro(&sender, &receiver, &results));
+
+  std::thread::id receiver_thread_id{};
+  std::thread receiver_thread([&] {
+    receiver_thread_id = std::this_thread::get_id();
+    receiver.start();
+  });
+  sender.start();
+  receiver_thread.join();
+
+  REQUIRE(results.received == std::vector<uint64_t>{1, 2});
+  REQUIRE(results.task_thread == receiver_thread_id);
+  REQUIRE(results.reply.data == 42);
+  REQUIRE(results.reply.value == 7);
+  REQUIRE(receiver.stats().posted_received == 3);
+  REQUIRE(sender.stats().posted_received == 1);
+}
+
+EvTask self_posting_coro(EventManager* ev, const std::vector<PostedMessage>* handled) {
+  co_await ev->post_message(ev, 5, -1);
+  co_await ev->post_message(ev, RequestTable::MAX_POSTED_PAYLOAD, 3);
+  while (handled->size() != 2) {
+    co_await ev->yield();
+  }
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Posted messages go to the message handler when no coroutine is waiting for one") {
+  std::vector<PostedMessage> handled{};
+
+  EventManager ev(8);
+  ev.set_message_handler([&](EventManager*, PostedMessage message) { handled.push_back(message); });
+  ev.register_coro(self_posting_coro(&ev, &handled));
+  ev.start();
+
+  REQUIRE(handled.size() == 2);
+  REQUIRE(handled[0].data == 5);
+  REQUIRE(handled[0].value == -1);
+  REQUIRE(handled[1].data == RequestTable::MAX_POSTED_PAYLOAD);
+  REQUIRE(handled[1].value == 3);
+}
+
+EvTask batched_posts_coro(EventManager* ev, EventManager* killed, size_t* num_posted, uint64_t* taken) {
+  // only the post to a loop which is still running gets queued
+  auto queue = ev->make_request_queue();
+  queue.queue_msg_ring(killed, 1, 0);
+  queue.queue_msg_ring(ev, RequestTable::MAX_POSTED_PAYLOAD + 1, 0);
+  queue.queue_msg_ring(ev, 2, 3);
+  co_await ev->submit_and_wait(queue, [&](RequestType req_type, CommunicationChannel* channel) {
+    if (req_type == RequestType::MSG_RING) {
+      (*num_posted)++;
+    }
+  });
+
+  auto message = ev->take_message();
+  while (!message.has_value()) {
+    co_await ev->yield();
+    message = ev->take_message();
+  }
+  *taken = message->data;
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Batched posts are only made to event managers which are still open to them") {
+  size_t num_posted = 0;
+  uint64_t taken = 0;
+
+  EventManager killed(8);
+  killed.register_coro(yield_then_kill_coro(&killed));
+  killed.start();
+
+  EventManager ev(8);
+  ev.register_coro(batched_posts_coro(&ev, &killed, &num_posted, &taken));
+  ev.start();
+
+  REQUIRE(num_posted == 1);
+  REQUIRE(taken == 2);
+  REQUIRE(killed.stats().posted_received == 0);
+}
+
+EvTask receive_one_coro(EventManager* ev, uint64_t* received) {
+  auto message = co_await ev->receive_message();
+  *received = message.data;
+  co_return 0;
+}
+
+EvTask post_then_take_coro(EventManager* ev, uint64_t* taken) {
+  co_await ev->post_message(ev, 9);
+  auto message = ev->take_message();
+  while (!message.has_value()) {
+    co_await ev->yield();
+    message = ev->take_message();
+  }
+  *taken = message->data;
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Messages aren't handed to receivers whose coroutine was destroyed") {
+  uint64_t received = 0;
+  uint64_t taken = 0;
+
+  EventManager ev(8);
+  auto task = receive_one_coro(&ev, &received);
+  task.start();
+
+  // destroys the coroutine while it's waiting for a message
+  task = placeholder_coro();
+  task.start();
+
+  ev.register_coro(post_then_take_coro(&ev, &taken));
+  ev.start();
+
+  REQUIRE(taken == 9);
+  REQUIRE(received == 0);
+}
+
+EvTask counting_coro(size_t* count) {
+  (*count)++;
+  co_return 0;
+}
+
+TEST_CASE("Other threads hand tasks and calls to a running loop through its inbox") {
+  constexpr size_t NUM_PRODUCERS = 4;
+  constexpr size_t ITEMS_PER_PRODUCER = 500;
+  size_t tasks_run = 0;
+  size_t calls_made = 0;
+
+  EventManager ev(8);
+  std::thread loop_thread([&] { ev.start(); });
+
+  std::vector<std::thread> producers{};
+  for (size_t i = 0; i < NUM_PRODUCERS; i++) {
+    producers.emplace_back([&] {
+      for (size_t j = 0; j < ITEMS_PER_PRODUCER; j++) {
+        ev.enqueue_task(counting_coro(&tasks_run));
+        ev.enqueue_call([&](EventManager*) { calls_made++; });
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  // handled in order, so this comes after everything the producers enqueued
+  ev.enqueue_call([](EventManager* ev) { ev->register_coro(ev->kill()); });
+  loop_thread.join();
+
+  REQUIRE(tasks_run == NUM_PRODUCERS * ITEMS_PER_PRODUCER);
+  REQUIRE(calls_made == NUM_PRODUCERS * ITEMS_PER_PRODUCER);
+}
+
+EvTask read_pipe_then_kill_coro(EventManager* ev, int fd) {
+  uint8_t byte{};
+  co_await ev->read(fd, &byte, 1);
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Loops whose queue was too full to read the inbox still wake up for calls") {
+  int fds[2]{};
+  REQUIRE(pipe(fds) == 0);
+  std::atomic<bool> called{false};
+
+  // the read takes the only SQE before the loop first tries to arm the inbox read
+  EventManager ev(1, {.submission_mode = SubmissionMode::DEFERRED});
+  ev.register_coro(read_pipe_then_kill_coro(&ev, fds[0]));
+  std::thread loop_thread([&] { ev.start(); });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ev.enqueue_call([&](EventManager*) {
+    called = true;
+    REQUIRE(write(fds[1], "x", 1) == 1);
+  });
+
+  // if the call never got the loop out of waiting, unblock it through the read instead
+  for (size_t i = 0; i < 200 && !called; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  const bool woken_by_call = called;
+  if (!woken_by_call) {
+    REQUIRE(write(fds[1], "x", 1) == 1);
+  }
+  loop_thread.join();
+  close(fds[0]);
+  close(fds[1]);
+
+  REQUIRE(woken_by_call);
+}
+
+struct OffloadResults {
+  size_t num_on_loop_after{};
+  size_t num_on_pool{};
+  bool caught_exception{};
+  bool ran_void_fn{};
+};
+
+EvTask offloading_coro(EventManager* ev, OffloadResults* results, size_t* remaining) {
+  const auto loop_thread = std::this_thread::get_id();
+
+  auto worker_thread = co_await ev->offload([] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));  // blocking call
+    return std::this_thread::get_id();
+  });
+  results->num_on_pool += worker_thread != loop_thread;
+  results->num_on_loop_after += std::this_thread::get_id() == loop_thread;
+
+  try {
+    co_await ev->offload([]() -> int { throw std::runtime_error("failed"); });
+  } catch (const std::runtime_error&) {
+    results->caught_exception = true;
+  }
+
+  co_await ev->offload([results] { results->ran_void_fn = true; });
+
+  if (--(*remaining) == 0) {
+    co_await ev->kill();
+  }
+  co_return 0;
+}
+
+TEST_CASE("Offloaded work runs on the pool and resumes the coroutine on its loop") {
+  constexpr size_t NUM_CORO = 8;
+  OffloadResults results{};
+  size_t remaining = NUM_CORO;
+
+  EventManager ev(8, {.offload_threads = 4});
+  for (size_t i = 0; i < NUM_CORO; i++) {
+    ev.register_coro(offloading_coro(&ev, &results, &remaining));
+  }
+  ev.start();
+
+  REQUIRE(results.num_on_pool == NUM_CORO);
+  REQUIRE(results.num_on_loop_after == NUM_CORO);
+  REQUIRE(results.caught_exception);
+  REQUIRE(results.ran_void_fn);
+  REQUIRE(ev.stats().posted_received == 3 * NUM_CORO);
+}
+
+EvTask finishing_yielder(EventManager* ev, size_t* remaining) {
+  co_await ev->yield();
+  (*remaining)--;
+  co_return 0;
+}
+
+EvTask finishing_offloader(EventManager* ev, size_t* remaining) {
+  co_await ev->offload([] { return 1; });
+  (*remaining)--;
+  co_return 0;
+}
+
+EvTask nested_yielder(EventManager* ev) {
+  co_await ev->yield();
+  co_return 1;
+}
+
+EvTask finishing_after_nested(EventManager* ev, size_t* remaining) {
+  co_await nested_yielder(ev);
+  (*remaining)--;
+  co_return 0;
+}
+
+EvTask managed_watcher(EventManager* ev, size_t* remaining, size_t* still_managed) {
+  while (*remaining != 0) {
+    co_await ev->yield();
+  }
+  co_await ev->yield();  // finished tasks are let go of at the end of the iteration they finished in
+  *still_managed = ev->managed_coroutines();
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Managed tasks are let go of however they finish") {
+  size_t remaining = 30;
+  size_t still_managed = SIZE_MAX;
+
+  EventManager ev(8, {.offload_threads = 2});
+  for (size_t i = 0; i < 10; i++) {
+    ev.register_coro(finishing_yielder(&ev, &remaining));
+    ev.register_coro(finishing_offloader(&ev, &remaining));
+    ev.register_coro(finishing_after_nested(&ev, &remaining));
+  }
+  ev.register_coro(managed_watcher(&ev, &remaining, &still_managed));
+  REQUIRE(ev.managed_coroutines() == 31);
+  ev.start();
+
+  REQUIRE(remaining == 0);
+  REQUIRE(still_managed == 1);  // only the watcher itself
+}
+
+EvTask statx_burst_coro(EventManager* ev, size_t* num_ok) {
+  struct statx statx_buf{};
+  for (size_t i = 0; i < 16; i++) {
+    auto res = co_await ev->statx(AT_FDCWD, "/", 0, STATX_BASIC_STATS, &statx_buf);
+    *num_ok += !ErrorProcessing::is_there_an_error(res.error);
+  }
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("io-wq worker limits can be set and read back") {
+  size_t num_ok = 0;
+
+  EventManager ev(8, {.io_wq_bounded_workers = 2, .io_wq_unbounded_workers = 3});
+  auto status = ev.io_wq_status();
+  REQUIRE(status.bounded_limit == 2);
+  REQUIRE(status.unbounded_limit == 3);
+
+  REQUIRE(ev.set_io_wq_limits(0, 5) == 0);
+  status = ev.io_wq_status();
+  REQUIRE(status.bounded_limit == 2);
+  REQUIRE(status.unbounded_limit == 5);
+
+  // operations still complete with the caps in place
+  ev.register_coro(statx_burst_coro(&ev, &num_ok));
+  ev.start();
+  REQUIRE(num_ok == 16);
+}
+
+struct ProvidedRecvResults {
+  std::string first{};
+  int first_buffer_id{-1};
+  size_t available_while_held{};
+  int exhausted_error{};
+  std::string after_release{};
+};
+
+EvTask provided_recv_coro(EventManager* ev, ProvidedBufferRing* buffers, int sockfd, int peer_fd,
+                          ProvidedRecvResults* results) {
+  REQUIRE(::write(peer_fd, "hello", 5) == 5);
+  auto res = co_await ev->recv_provided(sockfd, buffers);
+  REQUIRE(!ErrorProcessing::is_there_an_error(res.error));
+  auto first = buffers->claim(res.data);
+  results->first = std::string{reinterpret_cast<char*>(first.data()), first.size()};
+  results->first_buffer_id = res.data.buffer_id;
+  results->available_while_held = buffers->available();
+
+  // the only buffer is still held, so there's nothing for the kernel to pick
+  REQUIRE(::write(peer_fd, "again", 5) == 5);
+  res = co_await ev->recv_provided(sockfd, buffers);
+  results->exhausted_error = res.data.error_num;
+
+  first.release();
+  res = co_await ev->recv_provided(sockfd, buffers);
+  {
+    auto second = buffers->claim(res.data);
+    results->after_release = std::string{reinterpret_cast<char*>(second.data()), second.size()};
+  }
+
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Receives take buffers from a provided buffer ring and give them back") {
+  int fds[2]{};
+  REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  ProvidedRecvResults results{};
+
+  EventManager ev(8);
+  auto buffers = ev.setup_buffer_ring(1, 1, 64);
+  REQUIRE(buffers != nullptr);
+  REQUIRE(ev.setup_buffer_ring(1, 1, 64) == nullptr);  // the group is taken
+  REQUIRE(ev.setup_buffer_ring(2, 3, 64) == nullptr);  // not a power of two
+  REQUIRE(ev.buffer_ring(1) == buffers);
+
+  ev.register_coro(provided_recv_coro(&ev, buffers, fds[0], fds[1], &results));
+  ev.start();
+
+  REQUIRE(results.first == "hello");
+  REQUIRE(results.first_buffer_id == 0);
+  REQUIRE(results.available_while_held == 0);
+  REQUIRE(results.exhausted_error == ENOBUFS);
+  REQUIRE(results.after_release == "again");
+  REQUIRE(buffers->available() == 1);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+EvTask lost_recv_coro(EventManager* ev, ProvidedBufferRing* buffers, int sockfd) {
+  co_await ev->recv_provided(sockfd, buffers);
+  co_return 0;
+}
+
+EvTask recv_after_lost_coro(EventManager* ev, ProvidedBufferRing* buffers, int sockfd, int peer_fd,
+                            std::string* received) {
+  // wait for the forgotten recv's completion, which took the ring's only buffer
+  while (ev->stats().stale_cqes == 0) {
+    co_await ev->yield();
+  }
+
+  REQUIRE(::write(peer_fd, "found", 5) == 5);
+  auto res = co_await ev->recv_provided(sockfd, buffers);
+  REQUIRE(!ErrorProcessing::is_there_an_error(res.error));
+  {
+    auto buffer = buffers->claim(res.data);
+    *received = std::string{reinterpret_cast<char*>(buffer.data()), buffer.size()};
+  }
+
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Provided buffers taken by recvs of destroyed coroutines go back to their ring") {
+  int fds[2]{};
+  REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  std::string received{};
+
+  EventManager ev(8);
+  auto buffers = ev.setup_buffer_ring(3, 1, 64);
+  REQUIRE(buffers != nullptr);
+
+  auto task = lost_recv_coro(&ev, buffers, fds[0]);
+  task.start();
+
+  // destroys the suspended coroutine with its recv in flight, which then takes the only buffer
+  task = placeholder_coro();
+  task.start();
+  REQUIRE(::write(fds[1], "lost", 4) == 4);
+
+  ev.register_coro(recv_after_lost_coro(&ev, buffers, fds[0], fds[1], &received));
+  ev.start();
+
+  REQUIRE(received == "found");
+  REQUIRE(buffers->available() == 1);
+  REQUIRE(ev.stats().stale_cqes == 1);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+struct FixedBufferResults {
+  size_t bytes_wrote{};
+  size_t bytes_read{};
+  bool out_of_range_failed{};
+  std::string read_back{};
+  std::string from_spare_slot{};
+};
+
+EvTask fixed_buffers_coro(EventManager* ev, int fd, uint8_t* spare, FixedBufferResults* results) {
+  auto& table = ev->fixed_buffers();
+  std::memcpy(table.buffer(0) + 16, "fixed buffers", 13);
+
+  auto write_res = co_await ev->write_fixed(fd, 0, 16, 13, 0);
+  results->bytes_wrote = write_res.data.bytes_wrote;
+
+  // outside the registered buffer, so it's refused before it gets anywhere near the kernel
+  auto bad_res = co_await ev->read_fixed(fd, 1, table.length(1) - 4, 8, 0);
+  results->out_of_range_failed = ErrorProcessing::is_there_an_error(bad_res.error);
+
+  auto read_res = co_await ev->read_fixed(fd, 1, 0, 13, 0);
+  results->bytes_read = read_res.data.bytes_read;
+  results->read_back = std::string{reinterpret_cast<char*>(read_res.data.buff), read_res.data.bytes_read};
+
+  // the spare slot only works once something has been put in it
+  REQUIRE(table.update(2, spare, 64) == 0);
+  read_res = co_await ev->read_fixed(fd, 2, 0, 6, 6);
+  results->from_spare_slot = std::string{reinterpret_cast<char*>(spare), read_res.data.bytes_read};
+
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Registered buffers are read into and written from by index") {
+  const char* path = "fixed_buffers_test.txt";
+  int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  REQUIRE(fd >= 0);
+  uint8_t spare[64]{};
+  FixedBufferResults results{};
+
+  EventManager ev(8);
+  REQUIRE(ev.fixed_buffers().setup(2, 4096, 1) == 0);
+  REQUIRE(ev.fixed_buffers().setup(2, 4096) == -EBUSY);
+  REQUIRE(ev.fixed_buffers().size() == 3);
+  REQUIRE(ev.fixed_buffers().buffer(2) == nullptr);
+
+  ev.register_coro(fixed_buffers_coro(&ev, fd, spare, &results));
+  ev.start();
+
+  REQUIRE(results.bytes_wrote == 13);
+  REQUIRE(results.out_of_range_failed);
+  REQUIRE(results.bytes_read == 13);
+  REQUIRE(results.read_back == "fixed buffers");
+  REQUIRE(results.from_spare_slot == "buffer");
+
+  ::close(fd);
+  ::unlink(path);
+}
+
+struct FixedBatchResults {
+  size_t num_handled{};
+  size_t num_failed{};
+};
+
+EvTask fixed_batch_coro(EventManager* ev, int fd, FixedBatchResults* results) {
+  auto handler = [&](RequestType req_type, CommunicationChannel* channel) {
+    if (req_type == RequestType::WRITE) {
+      auto data = channel->consume_resp_data<RequestType::WRITE>();
+      if (data.has_value() && data->bytes_wrote == LOREM_IPSUM.length()) {
+        results->num_handled++;
+      } else {
+        results->num_failed++;
+      }
+    } else {
+      results->num_failed++;
+    }
+  };
+
+  // fills every SQE, so each one still holds a write (and its user data) from this batch
+  auto first = ev->make_request_queue();
+  for (size_t i = 0; i < 4; i++) {
+    first.queue_write(fd, get_write_data(LOREM_IPSUM), LOREM_IPSUM.length());
+  }
+  co_await ev->submit_and_wait(first, handler);
+
+  // the out of range read is refused without taking one of those SQEs, which would resend its write
+  auto second = ev->make_request_queue();
+  second.queue_write(fd, get_write_data(LOREM_IPSUM), LOREM_IPSUM.length());
+  second.queue_read_fixed(fd, 7, 0, 16);
+  second.queue_write(fd, get_write_data(LOREM_IPSUM), LOREM_IPSUM.length());
+  co_await ev->submit_and_wait(second, handler);
+
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Out of range fixed buffer requests in a batch are refused without submitting anything") {
+  int fd = open("/dev/null", O_WRONLY);
+  FixedBatchResults results{};
+
+  EventManager ev(4);
+  REQUIRE(ev.fixed_buffers().setup(1, 4096) == 0);
+  ev.register_coro(fixed_batch_coro(&ev, fd, &results));
+  ev.start();
+  close(fd);
+
+  REQUIRE(results.num_handled == 6);
+  REQUIRE(results.num_failed == 0);
+  REQUIRE(ev.stats().stale_cqes == 0);
+}
+
+struct BufferArenaResults {
+  size_t bytes_wrote{};
+  std::string read_back{};
+};
+
+EvTask buffer_arena_coro(EventManager* ev, int fd, BufferArenaResults* results) {
+  auto arena = ev->buffer_arena();
+  auto out = arena->allocate();
+  auto in = arena->allocate();
+  std::memcpy(out, "huge pages", 10);
+
+  // the arena's slabs were registered in order, so a slab's index is its fixed buffer index
+  auto out_index = static_cast<unsigned>(arena->slab_index(out));
+  auto write_res = co_await ev->write_fixed(fd, out_index, 0, 10, 0);
+  results->bytes_wrote = write_res.data.bytes_wrote;
+
+  auto read_res = co_await ev->read_fixed(fd, static_cast<unsigned>(arena->slab_index(in)), 0, 10, 0);
+  results->read_back = std::string{reinterpret_cast<char*>(in), read_res.data.bytes_read};
+
+  arena->release(out);
+  arena->release(in);
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Buffer arenas hand out aligned slabs, report their use and register as fixed buffers") {
+  const char* path = "buffer_arena_test.txt";
+  int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  REQUIRE(fd >= 0);
+  BufferArenaResults results{};
+
+  EventManager ev(8);
+  REQUIRE(ev.buffer_arena() == nullptr);
+  // rounded up to a whole huge page and whole pages
+  auto arena = ev.setup_buffer_arena(1, 60000);
+  REQUIRE(arena != nullptr);
+  REQUIRE(ev.setup_buffer_arena(1, 4096) == nullptr);
+  REQUIRE(arena->slab_size() == 61440);
+  REQUIRE(arena->num_slabs() == BufferArena::HUGE_PAGE_SIZE / 61440);
+  REQUIRE(reinterpret_cast<uintptr_t>(arena->slab(0)) % BufferArena::HUGE_PAGE_SIZE == 0);
+
+  std::vector<uint8_t*> slabs{};
+  while (auto slab = arena->allocate()) {
+    REQUIRE(reinterpret_cast<uintptr_t>(slab) % BufferArena::SMALL_PAGE_SIZE == 0);
+    slabs.push_back(slab);
+  }
+  auto stats = arena->stats();
+  REQUIRE(slabs.size() == arena->num_slabs());
+  REQUIRE(stats.slabs_in_use == stats.slabs);
+  REQUIRE(stats.utilisation() == 1.0);
+  REQUIRE(stats.failed_allocations == 1);
+
+  // addresses inside a slab, and slabs which are already free, are refused
+  REQUIRE_FALSE(arena->release(slabs[0] + 1));
+  for (auto slab : slabs) {
+    REQUIRE(arena->release(slab));
+  }
+  REQUIRE_FALSE(arena->release(slabs[0]));
+  stats = arena->stats();
+  REQUIRE(stats.slabs_in_use == 0);
+  REQUIRE(stats.peak_slabs_in_use == stats.slabs);
+  REQUIRE(stats.bytes == BufferArena::HUGE_PAGE_SIZE);
+
+  REQUIRE(ev.fixed_buffers().setup_from_arena(*arena) == 0);
+  REQUIRE(ev.fixed_buffers().size() == arena->num_slabs());
+  ev.register_coro(buffer_arena_coro(&ev, fd, &results));
+  ev.start();
+
+  REQUIRE(results.bytes_wrote == 10);
+  REQUIRE(results.read_back == "huge pages");
+
+  ::close(fd);
+  ::unlink(path);
+}
+
+struct AcceptStreamResults {
+  std::vector<int> accepted{};
+  size_t pending_before_next{};
+  bool armed_while_accepting{};
+  int end_error{};
+  bool ended{};
+  bool stream_destroyed_while_armed{};
+  ssize_t late_client_read{-1};
+};
+
+EvTask accept_stream_coro(EventManager* ev, int listen_fd, const sockaddr_in* addr,
+                          AcceptStreamResults* results) {
+  AcceptStream connections{ev, listen_fd};
+
+  // connect while the accept is armed, so every connection comes from the same request
+  co_await ev->yield();
+  std::vector<int> clients{};
+  for (int i = 0; i < 3; i++) {
+    clients.push_back(::socket(AF_INET, SOCK_STREAM, 0));
+    REQUIRE(::connect(clients.back(), reinterpret_cast<const sockaddr*>(addr), sizeof(*addr)) == 0);
+  }
+
+  for (int i = 0; i < 3; i++) {
+    auto res = co_await connections.next();
+    REQUIRE(!ErrorProcessing::is_there_an_error(res.error));
+    if (i == 0) {
+      results->pending_before_next = connections.pending();
+    }
+    results->accepted.push_back(res.data.fd);
+  }
+  results->armed_while_accepting = connections.armed();
+
+  connections.cancel();
+  auto res = co_await connections.next();
+  results->end_error = res.data.error_num;
+  results->ended = connections.ended();
+
+  int late_client = ::socket(AF_INET, SOCK_STREAM, 0);
+  {
+    // destroyed while it's still armed, with a connection accepted that it never got to see
+    AcceptStream forgotten{ev, listen_fd};
+    co_await ev->yield();
+    results->stream_destroyed_while_armed = forgotten.armed();
+    REQUIRE(::connect(late_client, reinterpret_cast<const sockaddr*>(addr), sizeof(*addr)) == 0);
+  }
+  for (int i = 0; i < 5; i++) {
+    co_await ev->yield();
+  }
+  // the accepted end was closed rather than leaked, so the client sees the connection end
+  char byte{};
+  results->late_client_read = ::recv(late_client, &byte, 1, MSG_DONTWAIT);
+  ::close(late_client);
+
+  for (auto fd : results->accepted) {
+    ::close(fd);
+  }
+  for (auto fd : clients) {
+    ::close(fd);
+  }
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Accept streams hand out many connections from one multishot accept until cancelled") {
+  int listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{.sin_family = AF_INET, .sin_port = 0, .sin_addr = {htonl(INADDR_LOOPBACK)}};
+  socklen_t addr_len = sizeof(addr);
+  REQUIRE(::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+  REQUIRE(::listen(listen_fd, 8) == 0);
+  REQUIRE(::getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len) == 0);
+
+  AcceptStreamResults results{};
+  EventManager ev(8);
+  ev.register_coro(accept_stream_coro(&ev, listen_fd, &addr, &results));
+  ev.start();
+
+  REQUIRE(results.accepted.size() == 3);
+  for (auto fd : results.accepted) {
+    REQUIRE(fd >= 0);
+  }
+  REQUIRE(results.pending_before_next == 2);  // the rest had already been accepted
+  REQUIRE(results.armed_while_accepting);
+  REQUIRE(results.end_error == ECANCELED);
+  REQUIRE(results.ended);
+  REQUIRE(results.stream_destroyed_while_armed);
+  REQUIRE(results.late_client_read == 0);
+
+  ::close(listen_fd);
+}
+
+EvTask next_connection_coro(AcceptStream* connections, int* accepted) {
+  auto res = co_await connections->next();
+  *accepted = res.data.fd;
+  co_return 0;
+}
+
+EvTask wait_for_pending_coro(EventManager* ev, AcceptStream* connections, size_t* pending) {
+  for (size_t i = 0; i < 50 && connections->pending() == 0; i++) {
+    co_await ev->yield();
+  }
+  *pending = connections->pending();
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Accept streams don't resume coroutines destroyed while waiting for a connection") {
+  int listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{.sin_family = AF_INET, .sin_port = 0, .sin_addr = {htonl(INADDR_LOOPBACK)}};
+  socklen_t addr_len = sizeof(addr);
+  REQUIRE(::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+  REQUIRE(::listen(listen_fd, 8) == 0);
+  REQUIRE(::getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len) == 0);
+  int accepted = -1;
+  size_t pending = 0;
+
+  EventManager ev(8);
+  int client = ::socket(AF_INET, SOCK_STREAM, 0);
+  {
+    AcceptStream connections{&ev, listen_fd};
+    auto task = next_connection_coro(&connections, &accepted);
+    task.start();
+
+    // destroys the coroutine while it's waiting, so the connection is left for someone else
+    task = placeholder_coro();
+    task.start();
+    REQUIRE(::connect(client, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0);
+
+    ev.register_coro(wait_for_pending_coro(&ev, &connections, &pending));
+    ev.start();
+  }
+
+  REQUIRE(accepted == -1);
+  REQUIRE(pending == 1);
+  ::close(client);
+  ::close(listen_fd);
+}
+
+struct DirectFileResults {
+  int accepted_slot{-1};
+  bool accepted_direct{};
+  std::string read_from_slot{};
+  int opened_slot{-1};
+  std::string read_from_file{};
+  int socket_slot{-1};
+  size_t in_use_before_close{};
+  size_t in_use_after_close{};
+};
+
+EvTask direct_files_coro(EventManager* ev, int client_fd, const char* path, DirectFileResults* results) {
+  // the listening socket was put in reserved slot 0, so accepting goes through the table too
+  auto accept_res = co_await ev->accept_direct(FixedFile{0}, nullptr, nullptr);
+  REQUIRE(!ErrorProcessing::is_there_an_error(accept_res.error));
+  results->accepted_slot = accept_res.data.fd;
+  results->accepted_direct = accept_res.data.direct;
+  FixedFile accepted{static_cast<unsigned>(accept_res.data.fd)};
+
+  REQUIRE(::write(client_fd, "ping", 4) == 4);
+  char buffer[16]{};
+  auto read_res = co_await ev->read(accepted, reinterpret_cast<uint8_t*>(buffer), sizeof(buffer));
+  results->read_from_slot = std::string{buffer, read_res.data.bytes_read};
+  co_await ev->write(accepted, reinterpret_cast<const uint8_t*>("pong"), 4);
+
+  auto open_res = co_await ev->openat_direct(AT_FDCWD, path, O_RDONLY, 0);
+  REQUIRE(!ErrorProcessing::is_there_an_error(open_res.error));
+  results->opened_slot = open_res.data.req_fd;
+  read_res = co_await ev->read(FixedFile{static_cast<unsigned>(open_res.data.req_fd)},
+                               reinterpret_cast<uint8_t*>(buffer), sizeof(buffer));
+  results->read_from_file = std::string{buffer, read_res.data.bytes_read};
+
+  auto socket_res = co_await ev->socket_direct(AF_INET, SOCK_STREAM, 0);
+  results->socket_slot = socket_res.data.fd;
+
+  results->in_use_before_close = ev->fixed_files().in_use();
+  auto close_res = co_await ev->close(accepted);
+  REQUIRE(!ErrorProcessing::is_there_an_error(close_res.error));
+  results->in_use_after_close = ev->fixed_files().in_use();
+
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Direct file table slots are filled by accept, openat and socket and used in place of fds") {
+  const char* path = "direct_files_test.txt";
+  int file_fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  REQUIRE(::write(file_fd, "from a file", 11) == 11);
+  ::close(file_fd);
+
+  int listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{.sin_family = AF_INET, .sin_port = 0, .sin_addr = {htonl(INADDR_LOOPBACK)}};
+  socklen_t addr_len = sizeof(addr);
+  REQUIRE(::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+  REQUIRE(::listen(listen_fd, 4) == 0);
+  REQUIRE(::getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len) == 0);
+
+  // already queued on the listening socket by the time accept_direct runs
+  int client_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  REQUIRE(::connect(client_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+
+  DirectFileResults results{};
+  EventManager ev(8);
+  REQUIRE(ev.fixed_files().setup(8, 1) == 0);
+  REQUIRE(ev.fixed_files().update(0, listen_fd) == 0);
+  REQUIRE(ev.fixed_files().update(3, listen_fd) == -EINVAL);  // not a reserved slot
+  ::close(listen_fd);  // the table holds its own reference
+
+  ev.register_coro(direct_files_coro(&ev, client_fd, path, &results));
+  ev.start();
+
+  char reply[4]{};
+  REQUIRE(::read(client_fd, reply, sizeof(reply)) == 4);
+  REQUIRE(std::string{reply, 4} == "pong");
+
+  REQUIRE(results.accepted_direct);
+  REQUIRE(results.accepted_slot >= 1);  // never one of the reserved slots
+  REQUIRE(results.read_from_slot == "ping");
+  REQUIRE(results.opened_slot >= 1);
+  REQUIRE(results.read_from_file == "from a file");
+  REQUIRE(results.socket_slot >= 1);
+  REQUIRE(results.in_use_before_close == 4);
+  REQUIRE(results.in_use_after_close == 3);
+
+  ::close(client_fd);
+  ::unlink(path);
+}
+
+TEST_CASE("IOBufs share blocks between slices and recycle them into the pool") {
+  IOBufPool pool{64};
+
+  auto buf = pool.allocate();
+  REQUIRE(buf.unique());
+  REQUIRE(buf.tailroom() == 64);
+  std::memcpy(buf.tail(), "hello world", 11);
+  buf.append(11);
+  REQUIRE(pool.available() == pool.capacity() - 1);
+
+  auto world = buf.slice(6, 100);
+  REQUIRE(std::string{reinterpret_cast<char*>(world.data()), world.size()} == "world");
+  REQUIRE(world.data() == buf.data() + 6);  // no copy
+  REQUIRE(buf.ref_count() == 2);
+  REQUIRE(buf.tailroom() == 0);  // shared, so nothing more may be written
+
+  buf.reset();
+  REQUIRE(world.unique());
+  REQUIRE(pool.available() == pool.capacity() - 1);
+  world.reset();
+  REQUIRE(pool.available() == pool.capacity());
+
+  // chains hand out tailroom for reads and drop what's been written from the front
+  IOBufChain chain{};
+  chain.reserve(pool, 100);
+  REQUIRE(chain.num_buffers() == 2);
+  REQUIRE(chain.tail_iovecs().size() == 2);
+  std::memcpy(chain.buffer(0).tail(), LOREM_IPSUM.data(), 64);
+  std::memcpy(chain.buffer(1).tail(), LOREM_IPSUM.data() + 64, 16);
+  chain.commit(80);
+  REQUIRE(chain.size() == 80);
+
+  auto middle = chain.slice(60, 10);
+  REQUIRE(middle.num_buffers() == 2);
+  char out[10]{};
+  REQUIRE(middle.copy_to(reinterpret_cast<uint8_t*>(out), sizeof(out)) == 10);
+  REQUIRE(std::string{out, 10} == LOREM_IPSUM.substr(60, 10));
+
+  chain.consume(70);
+  REQUIRE(chain.num_buffers() == 1);
+  REQUIRE(chain.size() == 10);
+  chain.clear();
+  middle.clear();
+  REQUIRE(pool.available() == pool.capacity());
+}
+
+TEST_CASE("IOBuf pools refuse empty blocks, which a reserve could never fill") {
+  IOBufPool pool{0};
+  REQUIRE(pool.block_size() != 0);
+
+  IOBufChain chain{};
+  chain.reserve(pool, 100);
+  REQUIRE(chain.num_buffers() == 1);
+  REQUIRE(chain.tail_iovecs()[0].iov_len == pool.block_size());
+}
+
+TEST_CASE("IOBuf chains only read into the tailroom after the last of their data") {
+  IOBufPool pool{64};
+
+  // a partly filled buffer followed by one holding the data which comes after it
+  auto first = pool.allocate();
+  std::memcpy(first.tail(), "abc", 3);
+  first.append(3);
+  auto second = pool.allocate();
+  std::memcpy(second.tail(), "def", 3);
+  second.append(3);
+
+  IOBufChain chain{};
+  chain.append(std::move(first));
+  chain.append(std::move(second));
+
+  // the first buffer's tailroom would put new bytes between "abc" and "def"
+  auto tails = chain.tail_iovecs();
+  REQUIRE(tails.size() == 1);
+  REQUIRE(tails[0].iov_base == chain.buffer(1).tail());
+
+  chain.reserve(pool, 100);
+  REQUIRE(chain.num_buffers() == 3);
+  tails = chain.tail_iovecs();
+  REQUIRE(tails.size() == 2);
+  std::memcpy(tails[0].iov_base, "ghi", 3);
+  chain.commit(3);
+
+  char out[9]{};
+  REQUIRE(chain.copy_to(reinterpret_cast<uint8_t*>(out), sizeof(out)) == 9);
+  REQUIRE(std::string{out, 9} == "abcdefghi");
+  REQUIRE(chain.buffer(0).size() == 3);
+}
+
+EvTask iobuf_pipeline_coro(EventManager* ev, int in_fd, int out_fd, size_t* bytes_forwarded) {
+  // read into pooled buffers, then forward a slice of what was read without copying it
+  IOBufChain chain{};
+  chain.reserve(ev->iobuf_pool(), LOREM_IPSUM.size());
+  auto read_res = co_await ev->readv(in_fd, chain);
+  chain.commit(read_res.data.bytes_read);
+
+  auto forward = chain.slice(6, chain.size() - 6);
+  while (!forward.empty()) {
+    auto write_res = co_await ev->writev(out_fd, forward);
+    if (ErrorProcessing::is_there_an_error(write_res.error)) {
+      break;
+    }
+    *bytes_forwarded += write_res.data.bytes_wrote;
+    forward.consume(write_res.data.bytes_wrote);
+  }
+
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("IOBuf chains are read into and written from with readv and writev") {
+  int in_pipe[2]{};
+  int out_pipe[2]{};
+  REQUIRE(pipe(in_pipe) == 0);
+  REQUIRE(pipe(out_pipe) == 0);
+  const auto size = static_cast<ssize_t>(LOREM_IPSUM.size());
+  REQUIRE(::write(in_pipe[1], LOREM_IPSUM.data(), LOREM_IPSUM.size()) == size);
+
+  size_t bytes_forwarded = 0;
+  EventManager ev(8, {.iobuf_block_size = 256});  // small blocks, so the data spans several of them
+  ev.register_coro(iobuf_pipeline_coro(&ev, in_pipe[0], out_pipe[1], &bytes_forwarded));
+  ev.start();
+
+  std::string forwarded(bytes_forwarded, '\0');
+  REQUIRE(::read(out_pipe[0], forwarded.data(), forwarded.size()) == static_cast<ssize_t>(bytes_forwarded));
+  REQUIRE(forwarded == LOREM_IPSUM.substr(6));
+  REQUIRE(ev.iobuf_pool().available() == ev.iobuf_pool().capacity());
+
+  for (int fd : {in_pipe[0], in_pipe[1], out_pipe[0], out_pipe[1]}) {
+    ::close(fd);
+  }
+}
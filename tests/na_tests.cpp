@@ -42,3 +42,55 @@ TEST_CASE("Non awaitable operations do not leak memory") {
   close(fd);
   unlink(path);
 }
+
+EvTask many_na_writes_coro(EventManager* ev, int fd, size_t num_writes, size_t wave_size,
+                           size_t* num_completed) {
+  static const std::string DATA = "data";
+  auto write_wave = [&](EventManager* ev) {
+    for (size_t i = 0; i < wave_size; i++) {
+      ev->write_na(fd, reinterpret_cast<const uint8_t*>(DATA.c_str()), DATA.size());
+    }
+  };
+
+  // each wave is only written once the one before it has completed, so request data is given back
+  // as fast as it's taken and the pool shouldn't keep growing
+  size_t num_written = wave_size;
+  write_wave(ev);
+  co_await ev->poll([&](EventManager* ev, RequestType type, CommunicationChannel* channel) {
+    if (type == RequestType::WRITE) {
+      auto data = channel->consume_resp_data<RequestType::WRITE>();
+      if (data.has_value() && data->bytes_wrote == DATA.size()) {
+        (*num_completed)++;
+      }
+    }
+    if (*num_completed == num_written && num_written < num_writes) {
+      num_written += wave_size;
+      write_wave(ev);
+    }
+    return *num_completed == num_writes ? PollingState::STOP_POLLING : PollingState::CONTINUE_POLLING;
+  });
+  co_await ev->kill();
+  co_return 0;
+}
+
+TEST_CASE("Request data is reused across many non awaitable operations") {
+  constexpr size_t NUM_WRITES = 64;
+  constexpr size_t QUEUE_DEPTH = 4;
+  int fd = open("/dev/null", O_WRONLY);
+  REQUIRE(fd >= 0);
+
+  // far more operations than the queue depth, so the request data has to be recycled
+  size_t num_completed = 0;
+  size_t chunks = 0;
+  {
+    EventManager ev(QUEUE_DEPTH);
+    ev.register_coro(many_na_writes_coro(&ev, fd, NUM_WRITES, QUEUE_DEPTH, &num_completed));
+    ev.start();
+    chunks = ev.request_data_chunks();
+  }
+  REQUIRE(num_completed == NUM_WRITES);
+  // a wave is written while the request data of the write completing the one before is still held
+  REQUIRE(chunks >= 1);
+  REQUIRE(chunks <= 2);
+  close(fd);
+}
@@ -0,0 +1,168 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "vendor/doctest/doctest/doctest.h"
+
+#include "coroutine/io_awaitables.hpp"
+#include "event_loop/event_manager_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <fcntl.h>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+struct SpawnResults {
+  std::mutex mutex{};
+  std::set<std::thread::id> thread_ids{};
+  std::atomic<size_t> num_done{};
+};
+
+EvTask pool_write_coro(EventManager* ev, SpawnResults* results) {
+  static const std::string DATA = "pooled";
+  int fd = open("/dev/null", O_WRONLY);
+
+  auto res = co_await ev->write(fd, reinterpret_cast<const uint8_t*>(DATA.c_str()), DATA.size());
+  co_await ev->close(fd);
+
+  if (!ErrorProcessing::is_there_an_error(res.error)) {
+    std::scoped_lock<std::mutex> lock{results->mutex};
+    results->thread_ids.insert(std::this_thread::get_id());
+  }
+  results->num_done++;
+  co_return 0;
+}
+
+bool wait_for(const std::atomic<size_t>& value, size_t expected) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (value.load() < expected && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return value.load() == expected;
+}
+
+TEST_CASE("Tasks spawned on each loop of the pool run on that loop's thread") {
+  for (bool shared_work_queue : {false, true}) {
+    constexpr size_t TASKS_PER_LOOP = 8;
+    SpawnResults results{};
+
+    EventManagerPool pool({.cpus = {0, -1}, .queue_depth = 32, .shared_work_queue = shared_work_queue});
+    REQUIRE(pool.size() == 2);
+
+    for (size_t core = 0; core < pool.size(); core++) {
+      for (size_t i = 0; i < TASKS_PER_LOOP; i++) {
+        REQUIRE(pool.spawn_on(core, pool_write_coro(pool.manager(core), &results)));
+      }
+    }
+
+    REQUIRE(wait_for(results.num_done, 2 * TASKS_PER_LOOP));
+    pool.shutdown();
+
+    REQUIRE(results.thread_ids.size() == 2);
+    REQUIRE(!results.thread_ids.contains(std::this_thread::get_id()));
+    REQUIRE(!pool.spawn_on(0, pool_write_coro(pool.manager(0), &results)));
+  }
+}
+
+TEST_CASE("Work stealing deque hands every item out exactly once") {
+  constexpr size_t NUM_ITEMS = 100000;
+  constexpr size_t NUM_THIEVES = 3;
+
+  // the deque only stores the addresses, so these stand in for coroutine frames
+  std::vector<uint8_t> items(NUM_ITEMS);
+  std::vector<std::atomic<uint8_t>> times_taken(NUM_ITEMS);
+  auto take = [&](std::coroutine_handle<> handle) {
+    times_taken[static_cast<uint8_t*>(handle.address()) - items.data()]++;
+  };
+
+  WorkStealingDeque deque{2};  // starts tiny so it has to grow while being stolen from
+  std::atomic<bool> done{};
+  std::vector<std::thread> thieves{};
+  for (size_t i = 0; i < NUM_THIEVES; i++) {
+    thieves.emplace_back([&] {
+      while (!done.load()) {
+        if (auto handle = deque.steal()) {
+          take(handle);
+        }
+      }
+    });
+  }
+
+  for (size_t i = 0; i < NUM_ITEMS; i++) {
+    deque.push(std::coroutine_handle<>::from_address(&items[i]));
+    if (i % 3 == 0) {
+      if (auto handle = deque.pop()) {
+        take(handle);
+      }
+    }
+  }
+  while (auto handle = deque.pop()) {
+    take(handle);
+  }
+
+  done = true;
+  for (auto& thief : thieves) {
+    thief.join();
+  }
+
+  size_t num_taken_once = 0;
+  for (auto& count : times_taken) {
+    num_taken_once += count.load() == 1;
+  }
+  REQUIRE(num_taken_once == NUM_ITEMS);
+}
+
+struct StealingResults {
+  std::atomic<std::thread::id> home_thread{};
+  std::atomic<size_t> ran_elsewhere{};
+  std::atomic<size_t> returned_home{};
+  std::atomic<size_t> num_done{};
+};
+
+EvTask migratable_coro(EventManager* ev, StealingResults* results) {
+  co_await ev->yield_migratable();
+
+  // stands in for CPU bound work, long enough for the idle loop to take some of these
+  auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+  while (std::chrono::steady_clock::now() < until) {
+  }
+  if (std::this_thread::get_id() != results->home_thread) {
+    results->ran_elsewhere++;
+  }
+
+  co_await ev->return_home();
+  if (std::this_thread::get_id() == results->home_thread) {
+    results->returned_home++;
+  }
+  results->num_done++;
+  co_return 0;
+}
+
+EvTask record_home_coro(StealingResults* results) {
+  results->home_thread = std::this_thread::get_id();
+  co_return 0;
+}
+
+TEST_CASE("Idle loops steal migratable coroutines, which then return to their home loop") {
+  constexpr size_t NUM_TASKS = 64;
+  StealingResults results{};
+
+  EventManagerPool pool({.cpus = {-1, -1}, .queue_depth = 32, .work_stealing = true});
+  REQUIRE(pool.spawn_on(0, record_home_coro(&results)));
+  while (results.home_thread.load() == std::thread::id{}) {
+    std::this_thread::yield();
+  }
+
+  for (size_t i = 0; i < NUM_TASKS; i++) {
+    REQUIRE(pool.spawn_on(0, migratable_coro(pool.manager(0), &results)));
+  }
+
+  REQUIRE(wait_for(results.num_done, NUM_TASKS));
+  pool.shutdown();
+
+  REQUIRE(results.returned_home == NUM_TASKS);
+  REQUIRE(results.ran_elsewhere > 0);
+  REQUIRE(pool.manager(1)->stats().steals == results.ran_elsewhere);
+}
@@ -0,0 +1,74 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "vendor/doctest/doctest/doctest.h"
+
+#include "coroutine/task.hpp"
+#include <stdexcept>
+
+EvTask count_down(size_t depth) {
+  if (depth == 0) {
+    co_return 0;
+  }
+  co_return 1 + co_await count_down(depth - 1);
+}
+
+EvTask run_count_down(size_t depth, uint64_t* result) {
+  *result = co_await count_down(depth);
+  co_return 0;
+}
+
+TEST_CASE("Deeply nested tasks return through every level") {
+  constexpr size_t DEPTH = 10'000;
+  uint64_t result = 0;
+
+  auto task = run_count_down(DEPTH, &result);
+  task.start();
+
+  REQUIRE(task.is_done());
+  REQUIRE(result == DEPTH);
+}
+
+EvTask throwing_task() {
+  throw std::runtime_error("nested failure");
+  co_return 0;
+}
+
+EvTask catching_task(bool* caught) {
+  try {
+    co_await throwing_task();
+  } catch (const std::runtime_error&) {
+    *caught = true;
+  }
+  co_return 0;
+}
+
+TEST_CASE("Exceptions in an awaited task are rethrown in the awaiting task") {
+  bool caught = false;
+
+  auto task = catching_task(&caught);
+  task.start();
+
+  REQUIRE(task.is_done());
+  REQUIRE(caught);
+}
+
+EvTask short_lived_task(uint64_t value) {
+  co_return value;
+}
+
+TEST_CASE("Task frames are reused from the frame pool") {
+  constexpr size_t NUM_TASKS = 100;
+
+  // warm the pool up first, so every task after this one should reuse its blocks
+  short_lived_task(0).start();
+  auto before = FramePool::stats();
+
+  for (size_t i = 0; i < NUM_TASKS; i++) {
+    auto task = short_lived_task(i);
+    task.start();
+    REQUIRE(task.is_done());
+  }
+
+  auto after = FramePool::stats();
+  REQUIRE(after.hits - before.hits >= 2 * NUM_TASKS);  // the frame and the task status block
+  REQUIRE(after.misses == before.misses);
+}